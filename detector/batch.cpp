@@ -0,0 +1,163 @@
+#include "batch.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+
+//FIXME: Only on POSIX:
+#include <errno.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+using namespace std;
+
+static bool has_suffix(const string & text, const string & suffix)
+{
+  if (text.size() < suffix.size())
+    return false;
+
+  for (size_t i = 0; i < suffix.size(); ++i)
+  {
+    if (tolower(text[text.size() - suffix.size() + i]) != tolower(suffix[i]))
+      return false;
+  }
+
+  return true;
+}
+
+string replace_extension(const string & filename, const string & extension)
+{
+  size_t dot = filename.find_last_of('.');
+  size_t slash = filename.find_last_of('/');
+  if (dot == string::npos || (slash != string::npos && dot < slash))
+    return filename + extension;
+  return filename.substr(0, dot) + extension;
+}
+
+string tag_filename(const string & filename, const string & tag)
+{
+  size_t dot = filename.find_last_of('.');
+  size_t slash = filename.find_last_of('/');
+  if (dot == string::npos || (slash != string::npos && dot < slash))
+    return filename + '.' + tag;
+  return filename.substr(0, dot) + '.' + tag + filename.substr(dot);
+}
+
+static string onsets_filename(const string & audio_filename)
+{
+  return replace_extension(audio_filename, ".onsets");
+}
+
+bool read_manifest(const string & filename, vector<job> & jobs)
+{
+  ifstream file(filename.c_str());
+  if (!file.is_open())
+  {
+    cerr << "Failed to open manifest file: " << filename << endl;
+    return false;
+  }
+
+  string line;
+  while (getline(file, line))
+  {
+    if (!line.empty() && line[line.size()-1] == '\r')
+      line.erase(line.size()-1);
+
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    size_t tab = line.find('\t');
+    if (tab == string::npos)
+      jobs.push_back(job(line, onsets_filename(line)));
+    else
+      jobs.push_back(job(line.substr(0, tab), line.substr(tab+1)));
+  }
+
+  return true;
+}
+
+static bool scan_directory(const string & input_dir,
+                           const string & output_dir,
+                           const string & relative_dir,
+                           const string & extension,
+                           vector<job> & jobs)
+{
+  string dir_path = input_dir + relative_dir;
+
+  DIR *dp;
+  struct dirent *dirp;
+  if((dp  = opendir(dir_path.c_str())) == NULL)
+  {
+    cerr << "Error(" << errno << ") opening directory " << dir_path << endl;
+    return false;
+  }
+
+  vector<string> subdirs;
+
+  while ((dirp = readdir(dp)) != NULL)
+  {
+    string name(dirp->d_name);
+    if (name == "." || name == "..")
+      continue;
+
+    string relative_path = relative_dir + '/' + name;
+    string path = input_dir + relative_path;
+
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+      continue;
+
+    if (S_ISDIR(info.st_mode))
+      subdirs.push_back(relative_path);
+    else if (S_ISREG(info.st_mode) && has_suffix(name, extension))
+      jobs.push_back(job(path, onsets_filename(output_dir + relative_path)));
+  }
+  closedir(dp);
+
+  for (size_t i = 0; i < subdirs.size(); ++i)
+  {
+    if (!scan_directory(input_dir, output_dir, subdirs[i], extension, jobs))
+      return false;
+  }
+
+  return true;
+}
+
+static bool job_input_less(const job & a, const job & b)
+{
+  return a.input < b.input;
+}
+
+bool scan_directory(const string & input_dir,
+                    const string & output_dir,
+                    vector<job> & jobs,
+                    const string & extension)
+{
+  size_t first = jobs.size();
+
+  if (!scan_directory(input_dir, output_dir, string(), extension, jobs))
+    return false;
+
+  sort(jobs.begin() + first, jobs.end(), job_input_less);
+
+  return true;
+}
+
+bool make_parent_directories(const string & filename)
+{
+  size_t pos = filename.find('/', 1);
+  while (pos != string::npos)
+  {
+    string dir = filename.substr(0, pos);
+    if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST)
+    {
+      cerr << "Error(" << errno << ") creating directory " << dir << endl;
+      return false;
+    }
+    pos = filename.find('/', pos + 1);
+  }
+  return true;
+}
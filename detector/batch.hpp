@@ -0,0 +1,46 @@
+#ifndef DRUM_DETECTOR_BATCH_INCLUDED
+#define DRUM_DETECTOR_BATCH_INCLUDED
+
+#include <string>
+#include <vector>
+
+struct job
+{
+  job(): channel(-1) {}
+  job(const std::string & in, const std::string & out): input(in), output(out), channel(-1) {}
+
+  std::string input;
+  std::string output;
+  // Optional feature cache to write.
+  std::string features;
+  // Input channel to analyse, or -1 to mix all channels.
+  int channel;
+};
+
+// Reads jobs from a manifest file with one job per line:
+//   <input file> TAB <output file>
+// When the output is omitted, it is the input with the extension
+// replaced by ".onsets". Empty lines and lines starting with '#' are skipped.
+bool read_manifest(const std::string & filename, std::vector<job> & jobs);
+
+// Adds a job for every file with the given extension found recursively
+// under 'input_dir', writing to a .onsets file at the same relative path
+// under 'output_dir'. Jobs are sorted by input path, so the order is
+// reproducible.
+bool scan_directory(const std::string & input_dir,
+                    const std::string & output_dir,
+                    std::vector<job> & jobs,
+                    const std::string & extension = ".wav");
+
+// Returns 'filename' with the extension (if any) replaced by 'extension',
+// which includes the dot.
+std::string replace_extension(const std::string & filename,
+                              const std::string & extension);
+
+// Returns 'filename' with "." and 'tag' inserted before the extension (if any).
+std::string tag_filename(const std::string & filename, const std::string & tag);
+
+// Creates all missing directories leading to 'filename'.
+bool make_parent_directories(const std::string & filename);
+
+#endif // DRUM_DETECTOR_BATCH_INCLUDED
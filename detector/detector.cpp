@@ -1,135 +1,584 @@
 #include "scripts.hpp"
-
-#include <marsyas/system/MarSystemManager.h>
-#include <marsyas/script/script.h>
-#include <marsyas/script/manager.h>
+#include "pipeline.hpp"
+#include "replay.hpp"
+#include "features.hpp"
+#include "batch.hpp"
+#include "work_queue.hpp"
+#include "wav_source.hpp"
 
 #include <iostream>
-#include <fstream>
 #include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <cstdlib>
+#include <cstdio>
+#include <sstream>
 #include <iomanip>
-#include <cmath>
 
-using namespace Marsyas;
+//FIXME: Only on POSIX:
+#include <unistd.h>
+
 using namespace std;
 
-struct onset
+static void print_usage()
 {
-  float time;
-  int type;
-  float strength;
+  cerr << "Usage:" << endl
+       << "  detector <input file> <output file>" << endl
+       << "  detector -m <manifest file>" << endl
+       << "  detector -d <input dir> [-o <output dir>]" << endl
+       << "  detector -r <sample rate> [-c <channels>] [-e <encoding>] [<input> [<output>]]" << endl
+       << "Options:" << endl
+       << "  -j <count>  Number of worker threads (default: 1)." << endl
+       << "  -s          Split channels: detect onsets in each channel of a file" << endl
+       << "              separately. Channel NN is written to <output> with \".chNN\"" << endl
+       << "              inserted before the extension." << endl
+       << "              Channels are spread over the worker threads." << endl
+       << "  -f          Flush the output file after every onset." << endl
+       << "  -r <rate>   Read raw interleaved PCM at this sample rate from <input>" << endl
+       << "              (a file, FIFO or \"-\" for stdin; default: stdin) and" << endl
+       << "              write onsets to <output> (default: stdout) as they are detected." << endl
+       << "  -c <count>  Number of PCM channels (default: 1)." << endl
+       << "  -A <rate>   Resample input files to this analysis rate, e.g. 22050," << endl
+       << "              with a proportional hop size. Onset times are unaffected." << endl
+       << "  -e <name>   PCM sample encoding: float32 (default) or int16." << endl
+       << "  -p          Profile tick times of each stage; print summary at exit." << endl
+       << "  -w          Also write per-frame features to a .features file" << endl
+       << "              next to each output file." << endl
+       << "  -x          Inputs are .features files: only redo peak picking" << endl
+       << "              and classification. With -d, scans for .features files." << endl
+       << "  -t <value>  Peak threshold (default: 1.7)." << endl
+       << "  -a <count>  Peak look-ahead in frames (default: 4; 0 with -l)." << endl
+       << "  -P <file>   Also detect with each parameter set in <file>, one per line" << endl
+       << "              as <key>=<value> pairs (e.g. peak_threshold=2 look_ahead=3)," << endl
+       << "              sharing the analysis. Set NN is written to <output> with" << endl
+       << "              \".pNN\" inserted before the extension." << endl
+       << "  -W <count>  Peak picking window in frames, at least 2 * -a + 1" << endl
+       << "              (default: 18)." << endl
+       << "  -M <mode>   Peak threshold: mean (default) or median of the window" << endl
+       << "              times -t, minimum before the peak times -R, or hybrid:" << endl
+       << "              both median and minimum." << endl
+       << "  -R <value>  Minimum rise ratio for -M minimum/hybrid (default: 2)." << endl
+       << "  -F <value>  Absolute minimum peak value (default: 0)." << endl
+       << "  -l          Low latency: leave out the low band (saves 1 frame)" << endl
+       << "              and detect peaks causally unless -a is given." << endl
+       << "  -k <value>  Minimum peak confidence (default: 0.1)." << endl
+       << "  -b <low>,<high>  Centroid boundaries between onset types" << endl
+       << "              (default: 0.04,0.3)." << endl
+       << "  -n          Don't refine onset times: block resolution only." << endl
+       << "  -g <value>  Skip spectral analysis of windows with at most this RMS" << endl
+       << "              (default: 0, only digital silence)." << endl
+       << endl
+       << "A manifest lists one job per line: <input file> TAB <output file>." << endl
+       << "With -d, every .wav file under <input dir> is written to a .onsets file" << endl
+       << "at the same relative path under <output dir> (default: current dir)." << endl
+       << "The algorithmic latency (onset to detection) is printed to stderr;" << endl
+       << "onset times are back-dated by it." << endl;
+}
+
+// Prints the outcome of each job in job order,
+// no matter in which order the workers complete them.
+
+class job_reporter
+{
+public:
+  job_reporter(const vector<job> & jobs):
+    m_jobs(jobs),
+    m_status(jobs.size(), pending),
+    m_next(0),
+    m_failure_count(0)
+  {}
+
+  void report(size_t index, bool ok)
+  {
+    lock_guard<mutex> lock(m_mutex);
+
+    m_status[index] = ok ? succeeded : failed;
+
+    while (m_next < m_jobs.size() && m_status[m_next] != pending)
+    {
+      const job & j = m_jobs[m_next];
+
+      if (m_jobs.size() > 1)
+        cout << j.input << " -> " << j.output << endl;
+
+      if (m_status[m_next] == failed)
+        ++m_failure_count;
+
+      ++m_next;
+    }
+  }
+
+  int failure_count() const { return m_failure_count; }
+
+private:
+  enum status { pending, succeeded, failed };
+
+  const vector<job> & m_jobs;
+  vector<status> m_status;
+  size_t m_next;
+  int m_failure_count;
+  mutex m_mutex;
 };
 
-int main(int argc, char *argv[])
+// Replaces every job with one job per input channel,
+// each writing to an output tagged with the channel number.
+static void split_channels(vector<job> & jobs)
 {
-  if (argc < 3)
+  vector<job> split;
+
+  for (size_t i = 0; i < jobs.size(); ++i)
   {
-    cerr << "Usage: <input file> <output file>" << endl;
-    return 1;
+    const job & j = jobs[i];
+
+    int channel_count = (int) Marsyas::WavSource::channelCount(j.input);
+    if (channel_count < 1)
+    {
+      // Fails again when run, reporting the error in order.
+      split.push_back(j);
+      continue;
+    }
+
+    for (int c = 0; c < channel_count; ++c)
+    {
+      ostringstream tag;
+      tag << "ch" << setw(2) << setfill('0') << (c + 1);
+
+      job channel_job(j.input, tag_filename(j.output, tag.str()));
+      channel_job.channel = c;
+      split.push_back(channel_job);
+    }
   }
 
-  char *input_filename = argv[1];
-  char *output_filename = argv[2];
+  jobs.swap(split);
+}
 
-  detector::registerScripts();
+static bool run_job(detection_engine *detection, const job & j, bool flush_each)
+{
+  if (!make_parent_directories(j.output))
+    return false;
+
+  onset_writer writer(flush_each);
+  if (!writer.open(j.output))
+    return false;
+
+  if (!j.features.empty() && !make_parent_directories(j.features))
+    return false;
 
-  ScriptTranslator translator;
-  MarSystem *system = translator.translateRegistered("detector.mrs");
-  if (!system)
+  bool ok = detection->run(j, writer);
+
+  // The last buffered onsets are only written here.
+  ok = writer.close() && ok;
+
+  return ok;
+}
+
+static void run_worker(int worker, detection_engine *detection,
+                       const vector<job> & jobs,
+                       bool flush_each,
+                       work_queue & queue,
+                       job_reporter & reporter)
+{
+  size_t index;
+  while (queue.pop(worker, index))
   {
-    cerr << "Failure loading script!" << endl;
-    return 1;
+    bool ok = run_job(detection, jobs[index], flush_each);
+    reporter.report(index, ok);
   }
+}
 
-  MarControlPtr input_control = system->control("input");
-  MarControlPtr output_control = system->control("output");
-  MarControlPtr done_control = system->control("done");
+int main(int argc, char *argv[])
+{
+  string manifest_filename;
+  string input_dir;
+  string output_dir(".");
+  int worker_count = 1;
+  bool flush_each = false;
+  double pcm_sample_rate = 0.0;
+  int pcm_channels = 1;
+  string pcm_encoding("float32");
+  bool profiling = false;
+  bool write_features = false;
+  bool replay = false;
+  bool low_latency = false;
+  bool look_ahead_given = false;
+  bool split = false;
+  double analysis_rate = 0.0;
+  string param_sets_filename;
+  detection_params params;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "m:d:o:j:sfr:c:e:A:pwxt:a:P:W:M:R:F:lk:b:ng:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'm':
+      manifest_filename = optarg;
+      break;
+    case 'd':
+      input_dir = optarg;
+      break;
+    case 'o':
+      output_dir = optarg;
+      break;
+    case 'j':
+      worker_count = atoi(optarg);
+      if (worker_count < 1)
+      {
+        cerr << "Invalid worker count: " << optarg << endl;
+        return 1;
+      }
+      break;
+    case 's':
+      split = true;
+      break;
+    case 'f':
+      flush_each = true;
+      break;
+    case 'r':
+      pcm_sample_rate = atof(optarg);
+      if (!(pcm_sample_rate > 0.0))
+      {
+        cerr << "Invalid sample rate: " << optarg << endl;
+        return 1;
+      }
+      break;
+    case 'c':
+      pcm_channels = atoi(optarg);
+      if (pcm_channels < 1)
+      {
+        cerr << "Invalid channel count: " << optarg << endl;
+        return 1;
+      }
+      break;
+    case 'e':
+      pcm_encoding = optarg;
+      if (pcm_encoding != "float32" && pcm_encoding != "int16")
+      {
+        cerr << "Invalid sample encoding: " << optarg << endl;
+        return 1;
+      }
+      break;
+    case 'A':
+      analysis_rate = atof(optarg);
+      if (!(analysis_rate > 0.0))
+      {
+        cerr << "Invalid analysis rate: " << optarg << endl;
+        return 1;
+      }
+      break;
+    case 'p':
+      profiling = true;
+      break;
+    case 'w':
+      write_features = true;
+      break;
+    case 'x':
+      replay = true;
+      break;
+    case 't':
+      params.peak_threshold = atof(optarg);
+      break;
+    case 'a':
+      params.look_ahead = atoi(optarg);
+      if (params.look_ahead < 0)
+      {
+        cerr << "Invalid look-ahead: " << optarg << endl;
+        return 1;
+      }
+      look_ahead_given = true;
+      break;
+    case 'P':
+      param_sets_filename = optarg;
+      break;
+    case 'W':
+      params.peak_window = atoi(optarg);
+      break;
+    case 'M':
+      params.peak_mode = optarg;
+      if (params.peak_mode != "mean" && params.peak_mode != "median" &&
+          params.peak_mode != "minimum" && params.peak_mode != "hybrid")
+      {
+        cerr << "Invalid peak threshold mode: " << optarg << endl;
+        return 1;
+      }
+      break;
+    case 'R':
+      params.rise_ratio = atof(optarg);
+      break;
+    case 'F':
+      params.peak_floor = atof(optarg);
+      break;
+    case 'l':
+      low_latency = true;
+      break;
+    case 'k':
+      params.min_confidence = atof(optarg);
+      break;
+    case 'b':
+      if (sscanf(optarg, "%lf,%lf", &params.low_centroid, &params.high_centroid) != 2)
+      {
+        cerr << "Invalid centroid boundaries: " << optarg << endl;
+        return 1;
+      }
+      break;
+    case 'n':
+      params.refine_time = false;
+      break;
+    case 'g':
+      params.silence_floor = atof(optarg);
+      if (!(params.silence_floor >= 0.0))
+      {
+        cerr << "Invalid silence floor: " << optarg << endl;
+        return 1;
+      }
+      break;
+    default:
+      print_usage();
+      return 1;
+    }
+  }
 
-  if ( input_control.isInvalid() ||
-       output_control.isInvalid() ||
-       done_control.isInvalid() )
+  if (low_latency)
   {
-    cerr << "Failure: Invalid script!" << endl;
-    delete system;
+    params.low_band = false;
+    if (!look_ahead_given)
+      params.look_ahead = 0;
+  }
+
+  // SlidingPeaker would otherwise widen the window to fit the neighbourhood
+  // of 'look_ahead' frames on either side of the peak.
+  if (params.peak_window < 2 * params.look_ahead + 1)
+  {
+    cerr << "Peak window must be at least 2 * look-ahead + 1 frames." << endl;
     return 1;
   }
 
-  input_control->setValue(string(input_filename));
-  //output_control->setValue(string("features.out"));
+  vector<job> jobs;
 
-  mrs_real sample_rate = system->remoteControl("sndfile/osrate")->to<mrs_real>();
-  mrs_natural block_size = system->remoteControl("sndfile/onSamples")->to<mrs_natural>();
-  mrs_real block_duration = block_size / sample_rate;
+  bool streaming = pcm_sample_rate > 0.0;
 
-  MarControlPtr output = system->getControl("mrs_realvec/processedData");
-  MarControlPtr confidence_ctl = system->remoteControl("onsets/confidence");
-  assert(!output.isInvalid());
-  assert(!confidence_ctl.isInvalid());
+  if (replay && (streaming || write_features || profiling))
+  {
+    cerr << "Option -x can not be combined with -r, -w or -p." << endl;
+    return 1;
+  }
 
-  MarSystem *rms_sys = system->remoteSystem("rms");
-  assert(rms_sys);
-  MarControlPtr rms_out = rms_sys->getControl("mrs_real/value");
-  assert(!rms_out.isInvalid());
+  if (analysis_rate > 0.0 && (streaming || replay))
+  {
+    cerr << "Option -A can not be combined with -r or -x." << endl;
+    return 1;
+  }
 
-  std::vector<onset> onsets;
-  int block = 0;
-  const int block_offset = 5;
+  if (split && (streaming || replay))
+  {
+    cerr << "Option -s can not be combined with -r or -x." << endl;
+    return 1;
+  }
 
-  while(!done_control->to<bool>())
+  vector<detection_params> param_sets;
+  if (!param_sets_filename.empty())
   {
-    system->tick();
+    if (replay)
+    {
+      cerr << "Option -P can not be combined with -x." << endl;
+      return 1;
+    }
+    if (!read_param_sets(param_sets_filename, params, param_sets))
+      return 1;
+  }
 
-    const realvec & data = output->to<realvec>();
-    assert(data.getSize() == 2);
+  if (streaming)
+  {
+    int arg_count = argc - optind;
+    if (arg_count > 2)
+    {
+      print_usage();
+      return 1;
+    }
+    string input = arg_count > 0 ? argv[optind] : "-";
+    string output = arg_count > 1 ? argv[optind+1] : "-";
+    jobs.push_back(job(input, output));
+    if (output == "-")
+      flush_each = true;
+  }
+  else if (!manifest_filename.empty())
+  {
+    if (!read_manifest(manifest_filename, jobs))
+      return 1;
+  }
+  else if (!input_dir.empty())
+  {
+    if (!scan_directory(input_dir, output_dir, jobs, replay ? ".features" : ".wav"))
+      return 1;
+  }
+  else if (argc - optind == 2)
+  {
+    jobs.push_back(job(argv[optind], argv[optind+1]));
+  }
+  else
+  {
+    print_usage();
+    return 1;
+  }
 
-    mrs_real confidence = confidence_ctl->to<mrs_real>();
+  if (split)
+    split_channels(jobs);
 
-    if (!(data(0) > 0.0) || confidence < 10.0 / 100.0)
+  if (!param_sets.empty())
+  {
+    for (size_t i = 0; i < jobs.size(); ++i)
     {
-      ++block;
-      continue;
+      if (jobs[i].output == "-")
+      {
+        cerr << "Option -P requires output files." << endl;
+        return 1;
+      }
     }
+  }
 
-    mrs_real centroid = data(1);
+  if (write_features)
+  {
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+      if (jobs[i].output == "-")
+      {
+        cerr << "Option -w requires output files." << endl;
+        return 1;
+      }
+      jobs[i].features = feature_cache_filename(jobs[i].output);
+    }
+  }
 
-    double rms = rms_out->to<mrs_real>();
+  if (worker_count > (int) jobs.size())
+    worker_count = (int) jobs.size();
+  if (worker_count < 1)
+    worker_count = 1;
 
-    onset o;
+  detector::registerScripts();
 
-    o.time = (block - block_offset + 0.5) * block_duration;
+  // Translate the script once per worker, and reuse it for all the files.
+  // Translation is done up front, on this thread only.
+  vector<detection_engine*> engines;
+  vector<pipeline*> pipelines;
+  for (int w = 0; w < worker_count; ++w)
+  {
+    detection_engine *engine;
 
-    if (centroid < 0.04)
-      o.type = 0;
-    else if (centroid < 0.3)
-      o.type = 1;
+    if (replay)
+    {
+      engine = new feature_replay(params);
+    }
     else
-      o.type = 2;
+    {
+      pipeline *detection =
+          new pipeline(streaming ? "stream.mrs" : "detector.mrs", params);
+      if (detection->valid())
+      {
+        if (streaming)
+          detection->set_pcm_format(pcm_sample_rate, pcm_channels, pcm_encoding);
+        if (analysis_rate > 0.0 && !detection->set_analysis_rate(analysis_rate))
+        {
+          for (size_t i = 0; i < engines.size(); ++i)
+            delete engines[i];
+          delete detection;
+          return 1;
+        }
+        for (size_t i = 0; i < param_sets.size(); ++i)
+        {
+          ostringstream tag;
+          tag << "p" << setw(2) << setfill('0') << (i + 1);
+          if (!detection->add_parameter_set(param_sets[i], tag.str()))
+          {
+            for (size_t k = 0; k < engines.size(); ++k)
+              delete engines[k];
+            delete detection;
+            return 1;
+          }
+        }
+        if (profiling)
+          detection->enable_profiling();
+      }
+      pipelines.push_back(detection);
+      engine = detection;
+    }
 
-    o.strength = rms;
+    engines.push_back(engine);
 
-    onsets.push_back(o);
+    if (!engine->valid())
+    {
+      for (size_t i = 0; i < engines.size(); ++i)
+        delete engines[i];
+      return 1;
+    }
+  }
 
-    ++block;
+  if (!pipelines.empty())
+  {
+    long latency = pipelines[0]->latency();
+    double rate = streaming ? pcm_sample_rate : analysis_rate;
+    cerr << "Latency: " << latency << " samples";
+    if (rate > 0.0)
+      cerr << " (" << latency * 1000.0 / rate << " ms)";
+    cerr << endl;
   }
 
-  string separator(",");
+  work_queue queue(jobs.size(), worker_count);
+  job_reporter reporter(jobs);
 
-  ofstream out_file(output_filename);
-  if (!out_file.is_open())
+  if (worker_count == 1)
   {
-    cerr << "Failed to open output file for writing: " << output_filename << endl;
-    return 1;
+    run_worker(0, engines[0], jobs, flush_each, queue, reporter);
+  }
+  else
+  {
+    vector<thread> workers;
+    for (int w = 0; w < worker_count; ++w)
+    {
+      workers.push_back(thread(run_worker, w, engines[w],
+                               std::cref(jobs), flush_each,
+                               std::ref(queue), std::ref(reporter)));
+    }
+    for (int w = 0; w < worker_count; ++w)
+      workers[w].join();
   }
 
-  for (int i = 0; i < onsets.size(); ++i)
+  if (profiling)
   {
-    out_file << onsets[i].time << separator
-             << onsets[i].type << separator
-             << onsets[i].strength
-             << endl;
+    tick_profiler *summary = pipelines[0]->profiler();
+    for (size_t i = 1; i < pipelines.size(); ++i)
+      summary->merge(*pipelines[i]->profiler());
+    summary->print(cerr);
+  }
+
+  if (!pipelines.empty())
+  {
+    long frames = 0, skipped = 0, low_band_skipped = 0;
+    for (size_t i = 0; i < pipelines.size(); ++i)
+    {
+      frames += pipelines[i]->frame_count();
+      skipped += pipelines[i]->skipped_count();
+      low_band_skipped += pipelines[i]->low_band_skipped_count();
+    }
+    cerr << "Silent frames skipped: "
+         << skipped << " (full band), "
+         << low_band_skipped << " (low band) of "
+         << frames << endl;
+  }
+
+  for (size_t i = 0; i < engines.size(); ++i)
+    delete engines[i];
+
+  int failure_count = reporter.failure_count();
+  if (failure_count)
+  {
+    cerr << "Failed: " << failure_count << " / " << jobs.size() << " files." << endl;
+    return 1;
   }
 
-  cout << "Done." << endl;
+  // Don't mix status with onsets written to stdout.
+  if (jobs.size() != 1 || jobs[0].output != "-")
+    cout << "Done." << endl;
 
   return 0;
 }
@@ -0,0 +1,23 @@
+#include "engine.hpp"
+#include "pcm_source.hpp"
+#include "wav_source.hpp"
+#include "frame_history.hpp"
+#include "silence_gate.hpp"
+#include "marsystems.hpp"
+
+using namespace Marsyas;
+
+MarSystemManager *get_marsystem_manager()
+{
+  static MarSystemManager *manager = 0;
+  if (!manager)
+  {
+    manager = new MarSystemManager;
+    manager->registerPrototype("PcmSource", new PcmSource("pcmsourcepr"));
+    manager->registerPrototype("WavSource", new WavSource("wavsourcepr"));
+    manager->registerPrototype("FrameHistory", new FrameHistory("framehistorypr"));
+    manager->registerPrototype("SilenceGate", new SilenceGate("silencegatepr"));
+    register_shared_marsystems(manager);
+  }
+  return manager;
+}
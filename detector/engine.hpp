@@ -0,0 +1,26 @@
+#ifndef DRUM_DETECTOR_ENGINE_INCLUDED
+#define DRUM_DETECTOR_ENGINE_INCLUDED
+
+#include "batch.hpp"
+#include "onset_writer.hpp"
+#include "marsystems.hpp"
+
+#include <marsyas/system/MarSystem.h>
+#include <marsyas/system/MarSystemManager.h>
+
+// Turns one job's input into onsets.
+// An engine is used by one thread at a time, but may run any number of jobs.
+
+class detection_engine
+{
+public:
+  virtual ~detection_engine() {}
+  virtual bool valid() const = 0;
+  virtual bool run(const job & j, onset_writer & writer) = 0;
+};
+
+// Manager with the MarSystems of this project registered.
+// Not thread-safe: translate scripts on one thread only.
+Marsyas::MarSystemManager *get_marsystem_manager();
+
+#endif // DRUM_DETECTOR_ENGINE_INCLUDED
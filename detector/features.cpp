@@ -0,0 +1,186 @@
+#include "features.hpp"
+#include "batch.hpp"
+
+#include <iostream>
+#include <cstring>
+
+//FIXME: Only on POSIX:
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+static const char cache_magic[8] = { 'D','R','U','M','F','E','A','T' };
+// Version 2: onset function includes the low band; 1 frame later.
+// Version 3: delays recorded in the header.
+static const uint32_t cache_version = 4;
+static const size_t write_buffer_frames = 4096;
+
+feature_cache_writer::feature_cache_writer():
+  m_file(0),
+  m_ok(false)
+{
+  m_buffer.reserve(write_buffer_frames);
+}
+
+feature_cache_writer::~feature_cache_writer()
+{
+  if (m_file)
+    close();
+}
+
+bool feature_cache_writer::open(const string & filename,
+                                double sample_rate, uint64_t block_size,
+                                uint32_t band_delay, uint32_t feature_delay)
+{
+  if (m_file)
+    close();
+
+  m_file = fopen(filename.c_str(), "wb");
+  if (!m_file)
+  {
+    cerr << "Failed to open feature cache for writing: " << filename << endl;
+    return false;
+  }
+
+  m_filename = filename;
+
+  memset(&m_header, 0, sizeof(m_header));
+  memcpy(m_header.magic, cache_magic, sizeof(cache_magic));
+  m_header.version = cache_version;
+  m_header.frame_size = sizeof(feature_frame);
+  m_header.sample_rate = sample_rate;
+  m_header.block_size = block_size;
+  m_header.frame_count = 0;
+  m_header.band_delay = band_delay;
+  m_header.feature_delay = feature_delay;
+
+  // Frame count is filled in on close.
+  m_ok = fwrite(&m_header, sizeof(m_header), 1, m_file) == 1;
+
+  return m_ok;
+}
+
+void feature_cache_writer::write(const feature_frame & frame)
+{
+  m_buffer.push_back(frame);
+  if (m_buffer.size() == write_buffer_frames)
+    flush_buffer();
+}
+
+void feature_cache_writer::flush_buffer()
+{
+  if (m_buffer.empty())
+    return;
+
+  if (fwrite(&m_buffer[0], sizeof(feature_frame), m_buffer.size(), m_file) != m_buffer.size())
+    m_ok = false;
+
+  m_header.frame_count += m_buffer.size();
+  m_buffer.clear();
+}
+
+bool feature_cache_writer::close()
+{
+  if (!m_file)
+    return false;
+
+  flush_buffer();
+
+  if (fseek(m_file, 0, SEEK_SET) != 0 ||
+      fwrite(&m_header, sizeof(m_header), 1, m_file) != 1)
+  {
+    m_ok = false;
+  }
+
+  if (fclose(m_file) != 0)
+    m_ok = false;
+
+  m_file = 0;
+
+  if (!m_ok)
+    cerr << "Failed to write feature cache: " << m_filename << endl;
+
+  return m_ok;
+}
+
+feature_cache::feature_cache():
+  m_data(0),
+  m_size(0),
+  m_header(0),
+  m_frames(0)
+{}
+
+feature_cache::~feature_cache()
+{
+  close();
+}
+
+bool feature_cache::open(const string & filename)
+{
+  close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+  {
+    cerr << "Error(" << errno << ") opening feature cache " << filename << endl;
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(feature_cache_header))
+  {
+    cerr << "Invalid feature cache: " << filename << endl;
+    ::close(fd);
+    return false;
+  }
+
+  void *data = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (data == MAP_FAILED)
+  {
+    cerr << "Error(" << errno << ") mapping feature cache " << filename << endl;
+    return false;
+  }
+
+  m_data = data;
+  m_size = info.st_size;
+  m_header = static_cast<const feature_cache_header*>(m_data);
+  m_frames = reinterpret_cast<const feature_frame*>(m_header + 1);
+
+  bool valid =
+      memcmp(m_header->magic, cache_magic, sizeof(cache_magic)) == 0 &&
+      m_header->version == cache_version &&
+      m_header->frame_size == sizeof(feature_frame) &&
+      m_header->frame_count <= (m_size - sizeof(feature_cache_header)) / sizeof(feature_frame);
+
+  if (!valid)
+  {
+    cerr << "Invalid feature cache: " << filename << endl;
+    close();
+    return false;
+  }
+
+  madvise(m_data, m_size, MADV_SEQUENTIAL);
+
+  return true;
+}
+
+void feature_cache::close()
+{
+  if (m_data)
+    munmap(m_data, m_size);
+  m_data = 0;
+  m_size = 0;
+  m_header = 0;
+  m_frames = 0;
+}
+
+string feature_cache_filename(const string & onsets_filename)
+{
+  return replace_extension(onsets_filename, ".features");
+}
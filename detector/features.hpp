@@ -0,0 +1,101 @@
+#ifndef DRUM_DETECTOR_FEATURES_INCLUDED
+#define DRUM_DETECTOR_FEATURES_INCLUDED
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Binary cache of the per-frame features computed by detector.mrs,
+// sufficient to redo peak picking and classification without the audio.
+//
+// File layout (native byte order):
+//   feature_cache_header
+//   feature_frame[frame_count]
+
+struct feature_frame
+{
+  // Onset function (spectral flux) of this frame, and spectral centroid
+  // as computed by onset_features for a peak reported in this frame.
+  // Kept at full precision, so replayed decisions match the original run.
+  double onset_function;
+  double centroid;
+  // RMS max/min around the onset, aligned like the centroid.
+  float rms_max;
+  float rms_min;
+  // Refined onset time of a peak reported in this frame without look-ahead,
+  // relative to its nominal time, in samples (see onset_features).
+  // A peak reported with look-ahead N uses the value N frames earlier.
+  float attack_offset;
+};
+
+struct feature_cache_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t frame_size;
+  double sample_rate;
+  uint64_t block_size;
+  uint64_t frame_count;
+  // detection_params::band_delay() and feature_delay() of the run:
+  // frames the onset function and centroid/RMS were delayed by.
+  uint32_t band_delay;
+  uint32_t feature_delay;
+};
+
+class feature_cache_writer
+{
+public:
+  feature_cache_writer();
+  ~feature_cache_writer();
+
+  bool open(const std::string & filename, double sample_rate, uint64_t block_size,
+            uint32_t band_delay, uint32_t feature_delay);
+  void write(const feature_frame & frame);
+  // Completes the header. Returns false on any write error.
+  bool close();
+
+  bool is_open() const { return m_file != 0; }
+
+private:
+  std::FILE *m_file;
+  std::string m_filename;
+  feature_cache_header m_header;
+  std::vector<feature_frame> m_buffer;
+  bool m_ok;
+
+  void flush_buffer();
+};
+
+// Read-only memory mapping of a feature cache file.
+
+class feature_cache
+{
+public:
+  feature_cache();
+  ~feature_cache();
+
+  bool open(const std::string & filename);
+  void close();
+
+  double sample_rate() const { return m_header->sample_rate; }
+  uint64_t block_size() const { return m_header->block_size; }
+  uint64_t frame_count() const { return m_header->frame_count; }
+  uint32_t band_delay() const { return m_header->band_delay; }
+  uint32_t feature_delay() const { return m_header->feature_delay; }
+  const feature_frame * frames() const { return m_frames; }
+
+private:
+  feature_cache(const feature_cache &);
+  feature_cache & operator=(const feature_cache &);
+
+  void *m_data;
+  size_t m_size;
+  const feature_cache_header *m_header;
+  const feature_frame *m_frames;
+};
+
+// Filename of the feature cache written alongside the given onsets file.
+std::string feature_cache_filename(const std::string & onsets_filename);
+
+#endif // DRUM_DETECTOR_FEATURES_INCLUDED
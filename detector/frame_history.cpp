@@ -0,0 +1,79 @@
+#include "frame_history.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+namespace Marsyas {
+
+FrameHistory::FrameHistory(string name):
+  MarSystem("FrameHistory", name),
+  m_frame_size(0),
+  m_frame_count(0),
+  m_pos(0)
+{
+  addControls();
+}
+
+FrameHistory::FrameHistory(const FrameHistory & other):
+  MarSystem(other),
+  m_frame_size(0),
+  m_frame_count(0),
+  m_pos(0)
+{
+  m_mem_size = getctrl("mrs_natural/memSize");
+  m_reset = getctrl("mrs_bool/reset");
+}
+
+void FrameHistory::addControls()
+{
+  addctrl("mrs_natural/memSize", (mrs_natural) 3, m_mem_size);
+  setctrlState("mrs_natural/memSize", true);
+  addctrl("mrs_bool/reset", false, m_reset);
+  setctrlState("mrs_bool/reset", true);
+}
+
+void FrameHistory::myUpdate(MarControlPtr sender)
+{
+  MarSystem::myUpdate(sender);
+
+  mrs_natural frame_size = ctrl_inObservations_->to<mrs_natural>() *
+      ctrl_inSamples_->to<mrs_natural>();
+  mrs_natural frame_count = std::max((mrs_natural) 1, m_mem_size->to<mrs_natural>());
+
+  if (frame_size != m_frame_size || frame_count != m_frame_count)
+  {
+    m_frame_size = frame_size;
+    m_frame_count = frame_count;
+    m_frames.assign(frame_size * frame_count, 0.0);
+    m_pos = 0;
+  }
+
+  if (m_reset->to<mrs_bool>())
+  {
+    std::fill(m_frames.begin(), m_frames.end(), 0.0);
+    m_pos = 0;
+    m_reset->setValue(false, NOUPDATE);
+  }
+}
+
+const mrs_real * FrameHistory::frame(mrs_natural age) const
+{
+  assert(age >= 0 && age < m_frame_count);
+  mrs_natural index = (m_pos + m_frame_count - 1 - age) % m_frame_count;
+  return &m_frames[index * m_frame_size];
+}
+
+void FrameHistory::myProcess(realvec & in, realvec & out)
+{
+  if (m_frame_size == 0)
+    return;
+
+  const mrs_real *data = in.getData();
+  std::copy(data, data + m_frame_size, &m_frames[m_pos * m_frame_size]);
+  std::copy(data, data + m_frame_size, out.getData());
+  m_pos = (m_pos + 1) % m_frame_count;
+}
+
+} // namespace Marsyas
@@ -0,0 +1,45 @@
+#ifndef DRUM_DETECTOR_FRAME_HISTORY_INCLUDED
+#define DRUM_DETECTOR_FRAME_HISTORY_INCLUDED
+
+#include <marsyas/system/MarSystem.h>
+
+#include <vector>
+
+namespace Marsyas {
+
+// Passes its input through unchanged, keeping the input of the last
+// 'memSize' ticks in a ring buffer, so that features can be computed
+// from it on demand (see onset_features) rather than on every tick.
+// Ticks not processed yet since the last 'reset' read as zeros.
+
+class FrameHistory: public MarSystem
+{
+public:
+  FrameHistory(std::string name);
+  FrameHistory(const FrameHistory & other);
+
+  MarSystem *clone() const { return new FrameHistory(*this); }
+
+  // Input of the tick 'age' ticks before the last one processed,
+  // in realvec layout (column-major). 'age' must be below 'memSize'.
+  const mrs_real * frame(mrs_natural age) const;
+  mrs_natural frameSize() const { return m_frame_size; }
+  mrs_natural frameObservations() const { return inObservations_; }
+
+private:
+  void addControls();
+  void myUpdate(MarControlPtr sender);
+  void myProcess(realvec & in, realvec & out);
+
+  MarControlPtr m_mem_size;
+  MarControlPtr m_reset;
+
+  mrs_natural m_frame_size;
+  mrs_natural m_frame_count;
+  std::vector<mrs_real> m_frames;
+  mrs_natural m_pos;
+};
+
+} // namespace Marsyas
+
+#endif // DRUM_DETECTOR_FRAME_HISTORY_INCLUDED
@@ -0,0 +1,159 @@
+#include "onset_features.hpp"
+#include "frame_history.hpp"
+#include "engine.hpp"
+#include "spectral_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Marsyas;
+using namespace std;
+
+onset_features::onset_features():
+  m_samples(0),
+  m_spectrum(0)
+{}
+
+onset_features::~onset_features()
+{
+  delete m_spectrum;
+}
+
+bool onset_features::attach(MarSystem *system)
+{
+  m_samples = dynamic_cast<FrameHistory*>(system->remoteSystem("analysis/samples"));
+  if (!m_samples)
+    return false;
+
+  if (!m_spectrum)
+  {
+    MarSystemManager *manager = get_marsystem_manager();
+    m_spectrum = manager->create("Series", "features");
+    m_spectrum->addMarSystem(manager->create("Windowing", "windowing"));
+    m_spectrum->addMarSystem(manager->create("Spectrum", "spectrum"));
+  }
+
+  return true;
+}
+
+// Same as Rms: over all values of one observation.
+static mrs_real rms(const mrs_real *samples, mrs_natural count)
+{
+  if (count == 0)
+    return 0.0;
+
+  mrs_real sum = 0.0;
+  for (mrs_natural i = 0; i < count; ++i)
+    sum += samples[i] * samples[i];
+  return std::sqrt(sum / count);
+}
+
+static mrs_real energy(const mrs_real *samples, mrs_natural count)
+{
+  mrs_real sum = 0.0;
+  for (mrs_natural i = 0; i < count; ++i)
+    sum += samples[i] * samples[i];
+  return sum;
+}
+
+// Adds the power spectrum of a packed spectrum (see spectral_kernels.hpp).
+static void add_power(const mrs_real *spectrum, mrs_natural n, vector<mrs_real> & power)
+{
+  mrs_natural half = n / 2;
+
+  power[0] += spectrum[0] * spectrum[0];
+  if (half == 0)
+    return;
+  power[half] += spectrum[1] * spectrum[1];
+  for (mrs_natural k = 1; k < half; ++k)
+  {
+    mrs_real re = spectrum[2 * k];
+    mrs_real im = spectrum[2 * k + 1];
+    power[k] += re * re + im * im;
+  }
+}
+
+void onset_features::compute(long delay, feature_frame & frame)
+{
+  mrs_natural window_size = m_samples->frameSize();
+
+  // The window size follows the hop size, which may change after attach().
+  if (m_window.getSize() != window_size)
+  {
+    m_spectrum->updControl("mrs_natural/inObservations", (mrs_natural) 1);
+    m_spectrum->updControl("mrs_natural/inSamples", window_size);
+    m_window.create(1, window_size);
+    m_spectrum_out.create(
+        m_spectrum->getControl("mrs_natural/onObservations")->to<mrs_natural>(),
+        m_spectrum->getControl("mrs_natural/onSamples")->to<mrs_natural>());
+  }
+
+  mrs_natural spectrum_size = m_spectrum_out.getSize();
+  m_power.assign(spectrum_size / 2 + 1, 0.0);
+
+  mrs_real rms_max = 0.0;
+  mrs_real rms_min = 0.0;
+
+  for (long age = delay; age < delay + 3; ++age)
+  {
+    const mrs_real *samples = m_samples->frame(age);
+
+    mrs_real value = rms(samples, window_size);
+    rms_max = age == delay ? value : std::max(rms_max, value);
+    rms_min = age == delay ? value : std::min(rms_min, value);
+
+    // Silent frames add no power.
+    if (value == 0.0)
+      continue;
+
+    std::copy(samples, samples + window_size, m_window.getData());
+    m_spectrum->process(m_window, m_spectrum_out);
+    add_power(m_spectrum_out.getData(), spectrum_size, m_power);
+  }
+
+  mrs_real moment0, moment1;
+  spectral_kernels_best().moments(&m_power[0], m_power.size(), &moment0, &moment1);
+
+  frame.centroid = moment0 > 0.0 ? moment1 / moment0 / m_power.size() : 0.0;
+  frame.rms_max = rms_max;
+  frame.rms_min = rms_min;
+}
+
+double onset_features::attack_offset(long age)
+{
+  // Windows are 2 hops long, advancing by 1 hop per frame.
+  mrs_natural hop_size = m_samples->frameSize() / 2;
+  mrs_natural step = hop_size / 8;
+  if (step < 1)
+    return 0.0;
+
+  // 3 hops: the first hop of the previous window, then the whole window.
+  const mrs_real *previous = m_samples->frame(age + 1);
+  const mrs_real *current = m_samples->frame(age);
+  mrs_natural step_count = 3 * hop_size / step;
+
+  mrs_real last = energy(previous, step);
+  mrs_real best_rise = 0.0;
+  mrs_natural best = -1;
+
+  for (mrs_natural k = 1; k < step_count; ++k)
+  {
+    mrs_natural start = k * step;
+    const mrs_real *samples = start < hop_size ?
+        previous + start : current + (start - hop_size);
+
+    mrs_real value = energy(samples, step);
+    if (value - last > best_rise)
+    {
+      best_rise = value - last;
+      best = k;
+    }
+    last = value;
+  }
+
+  if (best < 0)
+    return 0.0;
+
+  // The nominal time is half a hop before the centre of the window.
+  return best * step - 1.5 * hop_size;
+}
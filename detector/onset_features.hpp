@@ -0,0 +1,49 @@
+#ifndef DRUM_DETECTOR_ONSET_FEATURES_INCLUDED
+#define DRUM_DETECTOR_ONSET_FEATURES_INCLUDED
+
+#include "features.hpp"
+
+#include <marsyas/system/MarSystem.h>
+
+#include <vector>
+
+namespace Marsyas { class FrameHistory; }
+
+// Classification features of an onset - spectral centroid and RMS range -
+// computed on demand from the analysis windows of the last frames, kept by
+// "samples" in analysis.mrs. Only frames reported as onsets need them,
+// so this saves computing them for every frame. Spectra are computed with
+// the same Windowing and Spectrum as the full band of analysis.mrs.
+
+class onset_features
+{
+public:
+  onset_features();
+  ~onset_features();
+
+  // Finds the frame history below 'system'.
+  bool attach(Marsyas::MarSystem *system);
+
+  // Centroid of the power spectrum summed over 3 frames, and max/min of
+  // their RMS, for the 3 frames starting 'delay' frames before the last one.
+  // The frame history must hold at least delay + 3 frames.
+  void compute(long delay, feature_frame & frame);
+
+  // Refines the time of an onset reported for the frame 'age' frames before
+  // the last one: returns the offset in samples from its nominal time
+  // (see detection_params::onset_time) to the start of the steepest rise
+  // of energy, in steps of 1/8 hop, found in the windows of that frame and
+  // the one before. Returns 0 if the energy does not rise there.
+  // The frame history must hold at least age + 2 frames.
+  double attack_offset(long age);
+
+private:
+  Marsyas::FrameHistory *m_samples;
+  // Windowing -> Spectrum
+  Marsyas::MarSystem *m_spectrum;
+  Marsyas::realvec m_window;
+  Marsyas::realvec m_spectrum_out;
+  std::vector<Marsyas::mrs_real> m_power;
+};
+
+#endif // DRUM_DETECTOR_ONSET_FEATURES_INCLUDED
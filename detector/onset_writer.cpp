@@ -0,0 +1,58 @@
+#include "onset_writer.hpp"
+
+#include <iostream>
+
+using namespace std;
+
+onset_writer::onset_writer(bool flush_each):
+  m_buffer(buffer_size),
+  m_stream(&m_file),
+  m_flush_each(flush_each)
+{
+  // Must be set before opening the file to take effect.
+  m_file.rdbuf()->pubsetbuf(&m_buffer[0], m_buffer.size());
+}
+
+bool onset_writer::open(const string & filename)
+{
+  if (filename == "-")
+  {
+    m_stream = &cout;
+    return true;
+  }
+
+  m_stream = &m_file;
+  m_file.open(filename.c_str());
+  if (!m_file.is_open())
+  {
+    cerr << "Failed to open output file for writing: " << filename << endl;
+    return false;
+  }
+  return true;
+}
+
+void onset_writer::write(const onset & o)
+{
+  static const char separator = ',';
+
+  *m_stream << o.time << separator
+         << o.type << separator
+         << o.strength
+         << '\n';
+
+  if (m_flush_each)
+    m_stream->flush();
+}
+
+bool onset_writer::close()
+{
+  if (m_stream == &m_file)
+  {
+    // Sets failbit if the final flush fails.
+    m_file.close();
+    return !m_file.fail();
+  }
+
+  m_stream->flush();
+  return m_stream->good();
+}
@@ -0,0 +1,51 @@
+#ifndef DRUM_DETECTOR_ONSET_WRITER_INCLUDED
+#define DRUM_DETECTOR_ONSET_WRITER_INCLUDED
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct onset
+{
+  float time;
+  int type;
+  float strength;
+};
+
+// Receives onsets in the order they are detected.
+
+class onset_sink
+{
+public:
+  virtual ~onset_sink() {}
+  virtual void write(const onset &) = 0;
+};
+
+// Writes onsets as CSV lines while they are detected.
+// Output goes through a fixed-size buffer, so memory use does not depend
+// on the length of the input. With 'flush_each' enabled, every onset is
+// pushed to the file immediately, so readers can follow partial results.
+// The filename "-" selects stdout.
+
+class onset_writer: public onset_sink
+{
+public:
+  static const size_t buffer_size = 64 * 1024;
+
+  onset_writer(bool flush_each = false);
+
+  bool open(const std::string & filename);
+  void write(const onset &);
+  // Returns whether all output, including the final flush, was written.
+  bool close();
+
+  bool good() const { return m_stream->good(); }
+
+private:
+  std::vector<char> m_buffer;
+  std::ofstream m_file;
+  std::ostream *m_stream;
+  bool m_flush_each;
+};
+
+#endif // DRUM_DETECTOR_ONSET_WRITER_INCLUDED
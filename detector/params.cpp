@@ -0,0 +1,106 @@
+#include "params.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+using namespace std;
+
+static bool parse_number(const string & text, double & value)
+{
+  char *end;
+  value = strtod(text.c_str(), &end);
+  return !text.empty() && *end == 0;
+}
+
+bool set_param(detection_params & params, const string & key, const string & value)
+{
+  double number;
+
+  if (key == "peak_mode")
+  {
+    if (value != "mean" && value != "median" && value != "minimum" && value != "hybrid")
+      return false;
+    params.peak_mode = value;
+    return true;
+  }
+
+  if (!parse_number(value, number))
+    return false;
+
+  if (key == "peak_threshold")
+    params.peak_threshold = number;
+  else if (key == "look_ahead" && number >= 0)
+    params.look_ahead = (int) number;
+  else if (key == "peak_window" && number >= 1)
+    params.peak_window = (int) number;
+  else if (key == "rise_ratio")
+    params.rise_ratio = number;
+  else if (key == "peak_floor")
+    params.peak_floor = number;
+  else if (key == "min_confidence")
+    params.min_confidence = number;
+  else if (key == "low_centroid")
+    params.low_centroid = number;
+  else if (key == "high_centroid")
+    params.high_centroid = number;
+  else if (key == "refine_time")
+    params.refine_time = number != 0.0;
+  else
+    return false;
+
+  return true;
+}
+
+bool read_param_sets(const string & filename,
+                     const detection_params & base,
+                     vector<detection_params> & sets)
+{
+  ifstream file(filename.c_str());
+  if (!file.is_open())
+  {
+    cerr << "Failed to open parameter file: " << filename << endl;
+    return false;
+  }
+
+  string line;
+  int line_number = 0;
+  while (getline(file, line))
+  {
+    ++line_number;
+
+    if (!line.empty() && line[line.size()-1] == '\r')
+      line.erase(line.size()-1);
+
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    detection_params params = base;
+
+    istringstream fields(line);
+    string field;
+    while (fields >> field)
+    {
+      size_t equals = field.find('=');
+      if (equals == string::npos ||
+          !set_param(params, field.substr(0, equals), field.substr(equals + 1)))
+      {
+        cerr << filename << ":" << line_number
+             << ": Invalid parameter: " << field << endl;
+        return false;
+      }
+    }
+
+    if (params.peak_window < 2 * params.look_ahead + 1)
+    {
+      cerr << filename << ":" << line_number
+           << ": Peak window must be at least 2 * look-ahead + 1 frames." << endl;
+      return false;
+    }
+
+    sets.push_back(params);
+  }
+
+  return true;
+}
@@ -0,0 +1,143 @@
+#ifndef DRUM_DETECTOR_PARAMS_INCLUDED
+#define DRUM_DETECTOR_PARAMS_INCLUDED
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Tunable parameters of peak picking and onset classification,
+// and the latency they imply.
+
+struct detection_params
+{
+  detection_params():
+    peak_threshold(1.7),
+    look_ahead(4),
+    peak_window(18),
+    peak_mode("mean"),
+    rise_ratio(2.0),
+    peak_floor(0.0),
+    min_confidence(10.0 / 100.0),
+    low_centroid(0.04),
+    high_centroid(0.3),
+    low_band(true),
+    silence_floor(0.0),
+    refine_time(true)
+  {}
+
+  // Multiple of the mean onset function a peak must exceed.
+  // Applied to 'peak_threshold' of detector.mrs / 'threshold' of peaks.mrs.
+  double peak_threshold;
+
+  // Number of frames on each side of a peak it must be the maximum of:
+  // higher than those before it, not lower than those after it.
+  // Applied to 'look_ahead' of detector.mrs / peaks.mrs.
+  // With 0, peaks are detected causally: every frame exceeding the
+  // threshold is a peak, of which the first of a run is reported.
+  int look_ahead;
+
+  // Number of onset function frames whose mean (or median or minimum)
+  // the threshold applies to; at least 2 * 'look_ahead' + 1.
+  // Applied to 'peak_window' of detector.mrs / 'window' of peaks.mrs.
+  int peak_window;
+
+  // Threshold a peak must exceed: "mean" or "median" of the peak window
+  // times 'peak_threshold', "minimum" of the window before the peak times
+  // 'rise_ratio', or "hybrid" for both the median and minimum thresholds.
+  // Peaks must also exceed 'peak_floor'.
+  // Applied to 'peak_mode', 'rise_ratio' and 'peak_floor' of detector.mrs /
+  // 'mode', 'rise_ratio' and 'floor' of peaks.mrs.
+  std::string peak_mode;
+  double rise_ratio;
+  double peak_floor;
+
+  // Peaks with lower confidence are discarded.
+  double min_confidence;
+
+  // Spectral centroid class boundaries:
+  // type 0 below 'low_centroid', type 2 from 'high_centroid' up, else type 1.
+  double low_centroid;
+  double high_centroid;
+
+  // Whether the low band contributes to the onset function (see analysis.mrs).
+  // Lining it up with the full band costs 1 frame of latency.
+  bool low_band;
+
+  // Windows with an RMS of at most this value skip spectral analysis,
+  // with an onset function of 0. With 0, only digital silence is skipped,
+  // which does not change the results. Applied to 'silence_floor' of
+  // detector.mrs.
+  double silence_floor;
+
+  // Whether onset times are refined from the block resolution of
+  // onset_time() to the steepest energy rise around it (see onset_features).
+  bool refine_time;
+
+  // Frames the full band onset function is delayed by, to line up with
+  // the low band. The low band window is 4 hops at any hop size, so its
+  // centre trails the full band one by 1 hop. Applied to 'band_delay' of
+  // detector.mrs.
+  int band_delay() const
+  {
+    return low_band ? 1 : 0;
+  }
+
+  // Frames back from a detection that the centroid and RMS are taken at,
+  // so that the 3 frames they cover start at the peak frame, or end as late
+  // as possible with a short look-ahead. Applied to 'feature_delay' of
+  // detector.mrs, which sizes the frame histories for onset_features.
+  int feature_delay() const
+  {
+    return std::max(band_delay(), look_ahead + band_delay() - 2);
+  }
+
+  // Total algorithmic latency in samples, from an onset in the input
+  // to the end of the block in which it is detected, for 'block_size'
+  // samples per block (hop size). Sum of:
+  // - the distance to the centre of the analysis window (2 blocks long),
+  // - half a block, as onsets are placed in the middle of a block,
+  // - the band alignment delay,
+  // - the peak picking look-ahead.
+  long latency(long block_size) const
+  {
+    return block_size + block_size / 2 + (band_delay() + look_ahead) * block_size;
+  }
+
+  // Time of an onset detected in the given block, i.e. the end of that
+  // block back-dated by the latency.
+  double onset_time(long block, long block_size, double sample_rate) const
+  {
+    return ((block + 1) * (double) block_size - latency(block_size)) / sample_rate;
+  }
+
+  bool accept(double confidence) const
+  {
+    return !(confidence < min_confidence);
+  }
+
+  int type(double centroid) const
+  {
+    if (centroid < low_centroid)
+      return 0;
+    else if (centroid < high_centroid)
+      return 1;
+    else
+      return 2;
+  }
+};
+
+// Sets the parameter named like the member of detection_params to 'value'.
+// Only parameters of peak picking and classification can be set this way;
+// the others are shared by all parameter sets of a run (see pipeline).
+// Returns false for an unknown key or invalid value.
+bool set_param(detection_params & params, const std::string & key,
+               const std::string & value);
+
+// Reads parameter sets from a file with one set per line, each a
+// whitespace-separated list of <key>=<value> (see set_param) applied
+// to 'base'. Empty lines and lines starting with '#' are skipped.
+bool read_param_sets(const std::string & filename,
+                     const detection_params & base,
+                     std::vector<detection_params> & sets);
+
+#endif // DRUM_DETECTOR_PARAMS_INCLUDED
@@ -0,0 +1,156 @@
+#include "pcm_source.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+
+using namespace std;
+
+namespace Marsyas {
+
+PcmSource::PcmSource(string name):
+  MarSystem("PcmSource", name),
+  m_file(0),
+  m_sample_bytes(4)
+{
+  addControls();
+}
+
+PcmSource::PcmSource(const PcmSource & other):
+  MarSystem(other),
+  m_file(0),
+  m_sample_bytes(other.m_sample_bytes)
+{
+  m_filename = getctrl("mrs_string/filename");
+  m_encoding = getctrl("mrs_string/encoding");
+  m_channels = getctrl("mrs_natural/channels");
+  m_sample_rate = getctrl("mrs_real/sampleRate");
+  m_has_data = getctrl("mrs_bool/hasData");
+}
+
+PcmSource::~PcmSource()
+{
+  close();
+}
+
+void PcmSource::addControls()
+{
+  addctrl("mrs_string/filename", mrs_string(), m_filename);
+  setctrlState("mrs_string/filename", true);
+  addctrl("mrs_string/encoding", mrs_string("float32"), m_encoding);
+  setctrlState("mrs_string/encoding", true);
+  addctrl("mrs_natural/channels", (mrs_natural) 1, m_channels);
+  setctrlState("mrs_natural/channels", true);
+  addctrl("mrs_real/sampleRate", (mrs_real) 44100.0, m_sample_rate);
+  setctrlState("mrs_real/sampleRate", true);
+  addctrl("mrs_bool/hasData", false, m_has_data);
+}
+
+void PcmSource::open(const string & filename)
+{
+  close();
+
+  m_open_filename = filename;
+
+  if (filename.empty())
+    return;
+
+  if (filename == "-")
+    m_file = stdin;
+  else
+    m_file = fopen(filename.c_str(), "rb");
+
+  if (!m_file)
+  {
+    cerr << "PcmSource: Failed to open input: " << filename << endl;
+    return;
+  }
+
+  m_has_data->setValue(true, NOUPDATE);
+}
+
+void PcmSource::close()
+{
+  if (m_file && m_file != stdin)
+    fclose(m_file);
+  m_file = 0;
+  m_has_data->setValue(false, NOUPDATE);
+}
+
+void PcmSource::myUpdate(MarControlPtr sender)
+{
+  (void) sender;
+
+  const mrs_string & encoding = m_encoding->to<mrs_string>();
+  if (encoding == "int16")
+  {
+    m_sample_bytes = 2;
+  }
+  else
+  {
+    if (encoding != "float32")
+      cerr << "PcmSource: Unsupported encoding: " << encoding << ". Using float32." << endl;
+    m_sample_bytes = 4;
+  }
+
+  mrs_natural channels = std::max((mrs_natural) 1, m_channels->to<mrs_natural>());
+
+  ctrl_onObservations_->setValue(channels, NOUPDATE);
+  ctrl_onSamples_->setValue(ctrl_inSamples_, NOUPDATE);
+  ctrl_osrate_->setValue(m_sample_rate->to<mrs_real>(), NOUPDATE);
+
+  m_buffer.resize(m_sample_bytes * channels * ctrl_inSamples_->to<mrs_natural>());
+
+  const mrs_string & filename = m_filename->to<mrs_string>();
+  if (filename != m_open_filename)
+    open(filename);
+}
+
+void PcmSource::myProcess(realvec & in, realvec & out)
+{
+  (void) in;
+
+  out.setval(0.0);
+
+  if (!m_file)
+    return;
+
+  size_t frame_bytes = m_sample_bytes * onObservations_;
+  size_t byte_count = fread(&m_buffer[0], 1, m_buffer.size(), m_file);
+  mrs_natural frame_count = byte_count / frame_bytes;
+
+  const char *data = &m_buffer[0];
+
+  if (m_sample_bytes == 2)
+  {
+    for (mrs_natural t = 0; t < frame_count; ++t)
+    {
+      for (mrs_natural o = 0; o < onObservations_; ++o)
+      {
+        int16_t sample;
+        memcpy(&sample, data, sizeof(sample));
+        data += sizeof(sample);
+        out(o,t) = sample / 32768.0;
+      }
+    }
+  }
+  else
+  {
+    for (mrs_natural t = 0; t < frame_count; ++t)
+    {
+      for (mrs_natural o = 0; o < onObservations_; ++o)
+      {
+        float sample;
+        memcpy(&sample, data, sizeof(sample));
+        data += sizeof(sample);
+        out(o,t) = sample;
+      }
+    }
+  }
+
+  if (byte_count < m_buffer.size())
+    m_has_data->setValue(false);
+}
+
+} // namespace Marsyas
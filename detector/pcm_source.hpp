@@ -0,0 +1,49 @@
+#ifndef DRUM_DETECTOR_PCM_SOURCE_INCLUDED
+#define DRUM_DETECTOR_PCM_SOURCE_INCLUDED
+
+#include <marsyas/system/MarSystem.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Marsyas {
+
+// Reads raw interleaved PCM samples in native byte order from a file,
+// pipe or FIFO, or from stdin when 'filename' is "-".
+// Supported encodings: "float32", "int16".
+// Each tick blocks until 'inSamples' frames have arrived or the
+// stream ends; 'hasData' turns false at the end of the stream.
+
+class PcmSource: public MarSystem
+{
+public:
+  PcmSource(std::string name);
+  PcmSource(const PcmSource & other);
+  ~PcmSource();
+
+  MarSystem *clone() const { return new PcmSource(*this); }
+
+private:
+  void addControls();
+  void myUpdate(MarControlPtr sender);
+  void myProcess(realvec & in, realvec & out);
+
+  void open(const std::string & filename);
+  void close();
+
+  MarControlPtr m_filename;
+  MarControlPtr m_encoding;
+  MarControlPtr m_channels;
+  MarControlPtr m_sample_rate;
+  MarControlPtr m_has_data;
+
+  std::FILE *m_file;
+  std::string m_open_filename;
+  int m_sample_bytes;
+  std::vector<char> m_buffer;
+};
+
+} // namespace Marsyas
+
+#endif // DRUM_DETECTOR_PCM_SOURCE_INCLUDED
@@ -0,0 +1,96 @@
+#include "peak_picker.hpp"
+#include "engine.hpp"
+
+#include <marsyas/script/script.h>
+
+#include <iostream>
+
+using namespace Marsyas;
+using namespace std;
+
+peak_picker::peak_picker(const detection_params & params):
+  m_previous_peak(false)
+{
+  ScriptTranslator translator(get_marsystem_manager());
+  m_peaks = translator.translateRegistered("peaks.mrs");
+  if (!m_peaks)
+  {
+    cerr << "Failure loading script!" << endl;
+    return;
+  }
+
+  m_confidence = m_peaks->control("confidence");
+  m_threshold = m_peaks->control("threshold");
+  m_look_ahead = m_peaks->control("look_ahead");
+  m_window = m_peaks->control("window");
+  m_mode = m_peaks->control("mode");
+  m_rise_ratio = m_peaks->control("rise_ratio");
+  m_floor = m_peaks->control("floor");
+
+  if (m_confidence.isInvalid() ||
+      m_threshold.isInvalid() ||
+      m_look_ahead.isInvalid() ||
+      m_window.isInvalid() ||
+      m_mode.isInvalid() ||
+      m_rise_ratio.isInvalid() ||
+      m_floor.isInvalid())
+  {
+    cerr << "Failure: Invalid script!" << endl;
+    delete m_peaks;
+    m_peaks = 0;
+    return;
+  }
+
+  // One onset function value per tick, as in detector.mrs.
+  m_peaks->updControl("mrs_natural/inObservations", (mrs_natural) 1);
+  m_peaks->updControl("mrs_natural/inSamples", (mrs_natural) 1);
+
+  set_params(params);
+}
+
+peak_picker::~peak_picker()
+{
+  delete m_peaks;
+}
+
+void peak_picker::set_params(const detection_params & params)
+{
+  if (m_threshold->to<mrs_real>() != (mrs_real) params.peak_threshold)
+    m_threshold->setValue((mrs_real) params.peak_threshold);
+  if (m_look_ahead->to<mrs_natural>() != (mrs_natural) params.look_ahead)
+    m_look_ahead->setValue((mrs_natural) params.look_ahead);
+  if (m_window->to<mrs_natural>() != (mrs_natural) params.peak_window)
+    m_window->setValue((mrs_natural) params.peak_window);
+  if (m_mode->to<mrs_string>() != params.peak_mode)
+    m_mode->setValue((mrs_string) params.peak_mode);
+  if (m_rise_ratio->to<mrs_real>() != (mrs_real) params.rise_ratio)
+    m_rise_ratio->setValue((mrs_real) params.rise_ratio);
+  if (m_floor->to<mrs_real>() != (mrs_real) params.peak_floor)
+    m_floor->setValue((mrs_real) params.peak_floor);
+
+  m_in.create(1, 1);
+  m_out.create(m_peaks->getControl("mrs_natural/onObservations")->to<mrs_natural>(),
+               m_peaks->getControl("mrs_natural/onSamples")->to<mrs_natural>());
+}
+
+void peak_picker::reset()
+{
+  reset_state(m_peaks);
+  m_previous_peak = false;
+}
+
+bool peak_picker::process(double onset_function, double & confidence)
+{
+  m_in(0,0) = onset_function;
+  m_peaks->process(m_in, m_out);
+
+  bool peak = m_out(0,0) > 0.0;
+  bool repeated = peak && m_previous_peak && m_look_ahead->to<mrs_natural>() == 0;
+  m_previous_peak = peak;
+
+  if (!peak || repeated)
+    return false;
+
+  confidence = m_confidence->to<mrs_real>();
+  return true;
+}
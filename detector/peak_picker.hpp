@@ -0,0 +1,51 @@
+#ifndef DRUM_DETECTOR_PEAK_PICKER_INCLUDED
+#define DRUM_DETECTOR_PEAK_PICKER_INCLUDED
+
+#include "params.hpp"
+
+#include <marsyas/system/MarSystem.h>
+
+// Peak picking with the "peaks.mrs" script on one onset function value
+// at a time, as detector.mrs does per tick, with the peak parameters of
+// detection_params. Used where the onset function comes from elsewhere
+// than a running detector.mrs: a feature cache, or the shared analysis
+// of several parameter sets.
+
+class peak_picker
+{
+public:
+  peak_picker(const detection_params & params = detection_params());
+  ~peak_picker();
+
+  bool valid() const { return m_peaks != 0; }
+
+  // Applies the peak parameters, leaving unchanged ones alone.
+  void set_params(const detection_params & params);
+
+  // Clears the onset function history.
+  void reset();
+
+  // Takes the next onset function value. Returns true if it completes
+  // a new peak - 'look_ahead' values back - and sets its confidence.
+  // Without look-ahead, only the first of a run of peaks is returned,
+  // as in pipeline::run.
+  bool process(double onset_function, double & confidence);
+
+private:
+  peak_picker(const peak_picker &);
+  peak_picker & operator=(const peak_picker &);
+
+  Marsyas::MarSystem *m_peaks;
+  Marsyas::MarControlPtr m_confidence;
+  Marsyas::MarControlPtr m_threshold;
+  Marsyas::MarControlPtr m_look_ahead;
+  Marsyas::MarControlPtr m_window;
+  Marsyas::MarControlPtr m_mode;
+  Marsyas::MarControlPtr m_rise_ratio;
+  Marsyas::MarControlPtr m_floor;
+  Marsyas::realvec m_in;
+  Marsyas::realvec m_out;
+  bool m_previous_peak;
+};
+
+#endif // DRUM_DETECTOR_PEAK_PICKER_INCLUDED
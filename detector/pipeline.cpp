@@ -0,0 +1,339 @@
+#include "pipeline.hpp"
+#include "silence_gate.hpp"
+
+#include <marsyas/script/script.h>
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+
+using namespace Marsyas;
+using namespace std;
+
+static MarControlPtr value_control(MarSystem *system, const string & path)
+{
+  MarSystem *child = system->remoteSystem(path);
+  if (!child)
+    return MarControlPtr();
+  return child->getControl("mrs_real/value");
+}
+
+pipeline::pipeline(const string & script, const detection_params & params):
+  m_params(params),
+  m_profiler(0),
+  m_gate(0),
+  m_low_band_gate(0),
+  m_frame_count(0),
+  m_skipped_count(0),
+  m_low_band_skipped_count(0)
+{
+  ScriptTranslator translator(get_marsystem_manager());
+  m_system = translator.translateRegistered(script);
+  if (!m_system)
+  {
+    cerr << "Failure loading script!" << endl;
+    return;
+  }
+
+  m_input = m_system->control("input");
+  // Optional: only in scripts reading files.
+  m_channel = m_system->control("channel");
+  m_done = m_system->control("done");
+  m_sample_rate = m_system->remoteControl("sndfile/osrate");
+  m_block_size = m_system->remoteControl("sndfile/onSamples");
+  m_hop_size = m_system->control("hop_size");
+  m_output = m_system->getControl("mrs_realvec/processedData");
+  m_confidence = m_system->remoteControl("analysis/onsets/confidence");
+  m_onset_function = value_control(m_system, "analysis/onsets/odf");
+  m_gate = dynamic_cast<SilenceGate*>(m_system->remoteSystem("analysis/gate"));
+  m_low_band_gate = dynamic_cast<SilenceGate*>(m_system->remoteSystem("analysis/low_gate"));
+
+  MarControlPtr peak_threshold = m_system->control("peak_threshold");
+  MarControlPtr look_ahead = m_system->control("look_ahead");
+  MarControlPtr peak_window = m_system->control("peak_window");
+  MarControlPtr peak_mode = m_system->control("peak_mode");
+  MarControlPtr rise_ratio = m_system->control("rise_ratio");
+  MarControlPtr peak_floor = m_system->control("peak_floor");
+  MarControlPtr low_band_weight = m_system->control("low_band_weight");
+  MarControlPtr band_delay = m_system->control("band_delay");
+  m_feature_delay = m_system->control("feature_delay");
+  MarControlPtr silence_floor = m_system->control("silence_floor");
+
+  if ( m_input.isInvalid() ||
+       m_done.isInvalid() ||
+       m_sample_rate.isInvalid() ||
+       m_block_size.isInvalid() ||
+       m_hop_size.isInvalid() ||
+       m_output.isInvalid() ||
+       m_confidence.isInvalid() ||
+       m_onset_function.isInvalid() ||
+       !m_features.attach(m_system) ||
+       !m_gate ||
+       !m_low_band_gate ||
+       peak_threshold.isInvalid() ||
+       look_ahead.isInvalid() ||
+       peak_window.isInvalid() ||
+       peak_mode.isInvalid() ||
+       rise_ratio.isInvalid() ||
+       peak_floor.isInvalid() ||
+       low_band_weight.isInvalid() ||
+       band_delay.isInvalid() ||
+       m_feature_delay.isInvalid() ||
+       silence_floor.isInvalid() )
+  {
+    cerr << "Failure: Invalid script!" << endl;
+    delete m_system;
+    m_system = 0;
+    return;
+  }
+
+  peak_threshold->setValue((mrs_real) m_params.peak_threshold);
+  look_ahead->setValue((mrs_natural) m_params.look_ahead);
+  peak_window->setValue((mrs_natural) m_params.peak_window);
+  peak_mode->setValue((mrs_string) m_params.peak_mode);
+  rise_ratio->setValue((mrs_real) m_params.rise_ratio);
+  peak_floor->setValue((mrs_real) m_params.peak_floor);
+  band_delay->setValue((mrs_natural) m_params.band_delay());
+  m_feature_delay->setValue((mrs_natural) m_params.feature_delay());
+  silence_floor->setValue((mrs_real) m_params.silence_floor);
+  if (!m_params.low_band)
+    low_band_weight->setValue((mrs_real) 0.0);
+}
+
+pipeline::~pipeline()
+{
+  for (size_t i = 0; i < m_sets.size(); ++i)
+    delete m_sets[i];
+  delete m_profiler;
+  delete m_system;
+}
+
+void pipeline::set_pcm_format(mrs_real sample_rate,
+                              mrs_natural channels,
+                              const string & encoding)
+{
+  m_system->control("sample_rate")->setValue(sample_rate);
+  m_system->control("channels")->setValue(channels);
+  m_system->control("encoding")->setValue(encoding);
+}
+
+bool pipeline::set_analysis_rate(mrs_real sample_rate)
+{
+  MarControlPtr analysis_rate = m_system->control("analysis_rate");
+  if (analysis_rate.isInvalid())
+  {
+    cerr << "Failure: Script does not support an analysis rate!" << endl;
+    return false;
+  }
+
+  // Multiple of 8 samples, as required by the low band decimator.
+  // Both band windows follow the hop size, so band_delay() is unchanged.
+  mrs_natural hop_size = m_hop_size->to<mrs_natural>();
+  mrs_natural scaled = (mrs_natural) floor(hop_size * sample_rate / 44100.0 / 8.0 + 0.5) * 8;
+  if (scaled < 8)
+    scaled = 8;
+
+  m_hop_size->setValue(scaled);
+  analysis_rate->setValue(sample_rate);
+
+  return true;
+}
+
+bool pipeline::add_parameter_set(const detection_params & params, const string & tag)
+{
+  parameter_set *set = new parameter_set(params, tag);
+  if (!set->peaks.valid())
+  {
+    delete set;
+    return false;
+  }
+
+  // Shared by all sets.
+  set->params.low_band = m_params.low_band;
+  set->params.silence_floor = m_params.silence_floor;
+
+  // The sample history must cover the features of every set.
+  if (set->params.feature_delay() > m_feature_delay->to<mrs_natural>())
+    m_feature_delay->setValue((mrs_natural) set->params.feature_delay());
+
+  m_sets.push_back(set);
+
+  return true;
+}
+
+mrs_natural pipeline::block_size() const
+{
+  return m_hop_size->to<mrs_natural>();
+}
+
+void pipeline::enable_profiling()
+{
+  if (m_profiler)
+    return;
+
+  m_profiler = new tick_profiler;
+  m_profiler->attach(m_system);
+}
+
+void pipeline::reset()
+{
+  reset_state(m_system);
+}
+
+bool pipeline::run(const job & j, onset_writer & writer)
+{
+  assert(m_system);
+
+  if (!m_channel.isInvalid())
+  {
+    m_channel->setValue((mrs_natural) j.channel);
+  }
+  else if (j.channel != -1)
+  {
+    cerr << "Channel selection not supported for input: " << j.input << endl;
+    return false;
+  }
+
+  m_input->setValue(j.input);
+  reset();
+
+  mrs_real sample_rate = m_sample_rate->to<mrs_real>();
+  mrs_natural block_size = m_block_size->to<mrs_natural>();
+  if (!(sample_rate > 0.0))
+  {
+    cerr << "Failed to open input file: " << j.input << endl;
+    return false;
+  }
+
+  if (!j.features.empty())
+  {
+    if (!m_cache.open(j.features, sample_rate, block_size,
+                      m_params.band_delay(), m_params.feature_delay()))
+      return false;
+  }
+
+  for (size_t i = 0; i < m_sets.size(); ++i)
+  {
+    parameter_set & set = *m_sets[i];
+    set.peaks.reset();
+    if (!set.writer.open(tag_filename(j.output, set.tag)))
+    {
+      for (size_t k = 0; k < i; ++k)
+        m_sets[k]->writer.close();
+      if (m_cache.is_open())
+        m_cache.close();
+      return false;
+    }
+  }
+
+  long block = 0;
+  bool previous_peak = false;
+
+  while(!m_done->to<bool>())
+  {
+    if (m_profiler)
+      m_profiler->begin_tick();
+
+    m_system->tick();
+
+    if (m_profiler)
+      m_profiler->end_tick();
+
+    const realvec & data = m_output->to<realvec>();
+    assert(data.getSize() == 1);
+
+    feature_frame frame;
+    bool have_features = false;
+
+    if (m_cache.is_open())
+    {
+      frame.onset_function = m_onset_function->to<mrs_real>();
+      m_features.compute(m_params.feature_delay(), frame);
+      frame.attack_offset = m_features.attack_offset(m_params.band_delay());
+      have_features = true;
+      m_cache.write(frame);
+    }
+
+    mrs_real confidence = m_confidence->to<mrs_real>();
+
+    // Without look-ahead, every frame of a rise above the threshold is
+    // a peak: only keep the first of a run.
+    bool peak = data(0) > 0.0;
+    bool repeated = peak && previous_peak && m_params.look_ahead == 0;
+    previous_peak = peak;
+
+    if (peak && !repeated && m_params.accept(confidence))
+    {
+      if (m_profiler)
+        m_profiler->begin_report();
+
+      report(m_params, block, block_size, sample_rate,
+             have_features ? &frame : 0, writer);
+
+      if (m_profiler)
+        m_profiler->end_report();
+    }
+
+    if (!m_sets.empty())
+    {
+      mrs_real onset_function = m_onset_function->to<mrs_real>();
+      for (size_t i = 0; i < m_sets.size(); ++i)
+      {
+        parameter_set & set = *m_sets[i];
+        double set_confidence;
+        if (set.peaks.process(onset_function, set_confidence) &&
+            set.params.accept(set_confidence))
+        {
+          if (m_profiler)
+            m_profiler->begin_report();
+
+          report(set.params, block, block_size, sample_rate, 0, set.writer);
+
+          if (m_profiler)
+            m_profiler->end_report();
+        }
+      }
+    }
+
+    ++block;
+  }
+
+  m_frame_count += block;
+  m_skipped_count += m_gate->skippedCount();
+  m_low_band_skipped_count += m_low_band_gate->skippedCount();
+
+  bool ok = writer.good();
+
+  for (size_t i = 0; i < m_sets.size(); ++i)
+    ok = m_sets[i]->writer.close() && ok;
+
+  if (m_cache.is_open())
+    ok = m_cache.close() && ok;
+
+  return ok;
+}
+
+void pipeline::report(const detection_params & params, long block,
+                      mrs_natural block_size, mrs_real sample_rate,
+                      const feature_frame *features, onset_sink & sink)
+{
+  feature_frame frame;
+  if (!features)
+  {
+    m_features.compute(params.feature_delay(), frame);
+    features = &frame;
+  }
+
+  onset o;
+
+  o.time = params.onset_time(block, block_size, sample_rate);
+  if (params.refine_time)
+  {
+    long peak_age = params.band_delay() + params.look_ahead;
+    o.time += m_features.attack_offset(peak_age) / sample_rate;
+  }
+  o.type = params.type(features->centroid);
+  o.strength = features->rms_max;
+
+  sink.write(o);
+}
@@ -0,0 +1,114 @@
+#ifndef DRUM_DETECTOR_PIPELINE_INCLUDED
+#define DRUM_DETECTOR_PIPELINE_INCLUDED
+
+#include "engine.hpp"
+#include "params.hpp"
+#include "profiler.hpp"
+#include "features.hpp"
+#include "onset_features.hpp"
+#include "peak_picker.hpp"
+
+#include <marsyas/system/MarSystem.h>
+
+#include <string>
+#include <vector>
+
+namespace Marsyas { class SilenceGate; }
+
+// Detection pipeline translated once from a registered script -
+// "detector.mrs" for sound files or "stream.mrs" for raw PCM -
+// and reused for any number of inputs.
+
+class pipeline: public detection_engine
+{
+public:
+  pipeline(const std::string & script = "detector.mrs",
+           const detection_params & params = detection_params());
+  ~pipeline();
+
+  bool valid() const { return m_system != 0; }
+
+  // Only for "stream.mrs": format of the raw PCM input.
+  void set_pcm_format(Marsyas::mrs_real sample_rate,
+                      Marsyas::mrs_natural channels,
+                      const std::string & encoding);
+
+  // Only for "detector.mrs": resample all input to 'sample_rate'.
+  // The hop size is scaled by sample_rate / 44100, keeping the block
+  // duration the detection is tuned for (512 samples at 44.1 kHz).
+  bool set_analysis_rate(Marsyas::mrs_real sample_rate);
+
+  // Also detects onsets with 'params' from the same analysis, which is
+  // computed once for all parameter sets. Only the parameters of peak
+  // picking and classification (see set_param) are taken from 'params'.
+  // Onsets are written to the job output with "." and 'tag' inserted
+  // before the extension.
+  bool add_parameter_set(const detection_params & params, const std::string & tag);
+
+  // Samples per block (hop size) and the resulting algorithmic latency
+  // in samples (see detection_params::latency), at the analysis rate.
+  Marsyas::mrs_natural block_size() const;
+  long latency() const { return m_params.latency(block_size()); }
+
+  // Frames analysed, and frames skipped as silent in the full and low band
+  // (see SilenceGate), summed over all runs.
+  long frame_count() const { return m_frame_count; }
+  long skipped_count() const { return m_skipped_count; }
+  long low_band_skipped_count() const { return m_low_band_skipped_count; }
+
+  // Start recording tick times of every MarSystem in the pipeline.
+  void enable_profiling();
+  tick_profiler * profiler() { return m_profiler; }
+
+  // Onsets are passed to the writer as soon as they are detected.
+  // A job channel other than -1 requires a script with a 'channel' control.
+  // Centroid and RMS are only computed for accepted peaks, unless the job
+  // names a feature cache: then they are computed and written for every frame.
+  bool run(const job & j, onset_writer & writer);
+
+private:
+  struct parameter_set
+  {
+    parameter_set(const detection_params & p, const std::string & t):
+      params(p), tag(t), peaks(p) {}
+
+    detection_params params;
+    std::string tag;
+    peak_picker peaks;
+    onset_writer writer;
+  };
+
+  void reset();
+
+  // Writes an onset detected in 'block' with 'params', computing its
+  // features unless given.
+  void report(const detection_params & params, long block,
+              Marsyas::mrs_natural block_size, Marsyas::mrs_real sample_rate,
+              const feature_frame *features, onset_sink & sink);
+
+  detection_params m_params;
+
+  Marsyas::MarSystem *m_system;
+  tick_profiler *m_profiler;
+  std::vector<parameter_set*> m_sets;
+  feature_cache_writer m_cache;
+  onset_features m_features;
+  Marsyas::SilenceGate *m_gate;
+  Marsyas::SilenceGate *m_low_band_gate;
+  long m_frame_count;
+  long m_skipped_count;
+  long m_low_band_skipped_count;
+
+  Marsyas::MarControlPtr m_input;
+  Marsyas::MarControlPtr m_channel;
+  Marsyas::MarControlPtr m_done;
+  Marsyas::MarControlPtr m_sample_rate;
+  Marsyas::MarControlPtr m_block_size;
+  Marsyas::MarControlPtr m_hop_size;
+  Marsyas::MarControlPtr m_output;
+  Marsyas::MarControlPtr m_confidence;
+  Marsyas::MarControlPtr m_onset_function;
+  Marsyas::MarControlPtr m_feature_delay;
+};
+
+#endif // DRUM_DETECTOR_PIPELINE_INCLUDED
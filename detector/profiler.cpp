@@ -0,0 +1,231 @@
+#include "profiler.hpp"
+
+#include <cmath>
+#include <iomanip>
+#include <algorithm>
+
+using namespace Marsyas;
+using namespace std;
+
+duration_histogram::duration_histogram():
+  m_bins(bins_per_octave * octave_count, 0),
+  m_count(0),
+  m_total(0.0),
+  m_max(0.0)
+{}
+
+void duration_histogram::add(double nanoseconds)
+{
+  int bin = 0;
+  if (nanoseconds > 1.0)
+    bin = (int) (std::log2(nanoseconds) * bins_per_octave);
+  bin = std::min(bin, (int) m_bins.size() - 1);
+
+  ++m_bins[bin];
+  ++m_count;
+  m_total += nanoseconds;
+  m_max = std::max(m_max, nanoseconds);
+}
+
+void duration_histogram::merge(const duration_histogram & other)
+{
+  for (size_t i = 0; i < m_bins.size(); ++i)
+    m_bins[i] += other.m_bins[i];
+  m_count += other.m_count;
+  m_total += other.m_total;
+  m_max = std::max(m_max, other.m_max);
+}
+
+double duration_histogram::percentile(double fraction) const
+{
+  if (!m_count)
+    return 0.0;
+
+  uint64_t rank = (uint64_t) std::ceil(fraction * m_count);
+  if (rank < 1)
+    rank = 1;
+
+  uint64_t accumulated = 0;
+  for (size_t i = 0; i < m_bins.size(); ++i)
+  {
+    accumulated += m_bins[i];
+    if (accumulated >= rank)
+    {
+      // Geometric center of the bin, but never above the true maximum.
+      double value = std::exp2((i + 0.5) / bins_per_octave);
+      return std::min(value, m_max);
+    }
+  }
+
+  return m_max;
+}
+
+void tick_profiler::stage::preProcess(const realvec &)
+{
+  start = clock::now();
+}
+
+void tick_profiler::stage::postProcess(const realvec &)
+{
+  std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+  durations.add(elapsed.count());
+}
+
+tick_profiler::tick_profiler()
+{}
+
+tick_profiler::~tick_profiler()
+{
+  detach();
+  for (size_t i = 0; i < m_stages.size(); ++i)
+    delete m_stages[i];
+}
+
+void tick_profiler::attach(MarSystem *root)
+{
+  add_stages(root, root->getType() + '/' + root->getName(), 0);
+}
+
+void tick_profiler::add_stages(MarSystem *system, const string & path, int depth)
+{
+  stage *s = new stage(system, path, depth);
+  system->addObserver(s);
+  m_stages.push_back(s);
+
+  vector<MarSystem*> children = system->getChildren();
+  for (size_t i = 0; i < children.size(); ++i)
+  {
+    MarSystem *child = children[i];
+    add_stages(child, path + '/' + child->getType() + '/' + child->getName(), depth + 1);
+  }
+}
+
+void tick_profiler::detach()
+{
+  for (size_t i = 0; i < m_stages.size(); ++i)
+  {
+    stage *s = m_stages[i];
+    if (s->system)
+    {
+      s->system->removeObserver(s);
+      s->system = 0;
+    }
+  }
+}
+
+void tick_profiler::begin_tick()
+{
+  m_tick_start = clock::now();
+}
+
+void tick_profiler::end_tick()
+{
+  std::chrono::duration<double, std::nano> elapsed = clock::now() - m_tick_start;
+  m_ticks.add(elapsed.count());
+}
+
+void tick_profiler::begin_report()
+{
+  m_report_start = clock::now();
+}
+
+void tick_profiler::end_report()
+{
+  std::chrono::duration<double, std::nano> elapsed = clock::now() - m_report_start;
+  m_reports.add(elapsed.count());
+}
+
+void tick_profiler::merge(const tick_profiler & other)
+{
+  m_ticks.merge(other.m_ticks);
+  m_reports.merge(other.m_reports);
+
+  for (size_t i = 0; i < other.m_stages.size(); ++i)
+  {
+    const stage *theirs = other.m_stages[i];
+
+    stage *ours = 0;
+    for (size_t k = 0; k < m_stages.size(); ++k)
+    {
+      if (m_stages[k]->path == theirs->path)
+      {
+        ours = m_stages[k];
+        break;
+      }
+    }
+
+    if (!ours)
+    {
+      ours = new stage(0, theirs->path, theirs->depth);
+      m_stages.push_back(ours);
+    }
+
+    ours->durations.merge(theirs->durations);
+  }
+}
+
+static void print_row(ostream & out, const string & name,
+                      const duration_histogram & durations,
+                      double total_time)
+{
+  const double us = 1e-3;
+  const double ms = 1e-6;
+
+  double share = total_time > 0.0 ? durations.total() / total_time : 0.0;
+
+  out << setw(10) << durations.count()
+      << setw(10) << durations.percentile(0.5) * us
+      << setw(10) << durations.percentile(0.99) * us
+      << setw(10) << durations.max() * us
+      << setw(12) << durations.total() * ms
+      << setw(8) << share * 100.0
+      << "  " << name
+      << endl;
+}
+
+void tick_profiler::print(ostream & out) const
+{
+  ios::fmtflags flags = out.flags();
+  streamsize precision = out.precision();
+
+  out << fixed << setprecision(1);
+
+  out << "Wall time per tick or report (us), total (ms) and share of total time"
+      << " in ticks and onset reports (%)."
+      << endl
+      << "Composite stages include the time of their children."
+      << " Onset features are computed in [report], outside the ticks."
+      << endl;
+
+  out << setw(10) << "count"
+      << setw(10) << "p50"
+      << setw(10) << "p99"
+      << setw(10) << "max"
+      << setw(12) << "total"
+      << setw(8) << "share"
+      << "  stage"
+      << endl;
+
+  double total_time = m_ticks.total() + m_reports.total();
+
+  print_row(out, "[report]", m_reports, total_time);
+  print_row(out, "[tick]", m_ticks, total_time);
+
+  for (size_t i = 0; i < m_stages.size(); ++i)
+  {
+    const stage *s = m_stages[i];
+
+    // Show the last path component, indented by depth.
+    size_t type_start = string::npos;
+    size_t slash = s->path.rfind('/');
+    if (slash != string::npos && slash > 0)
+      type_start = s->path.rfind('/', slash - 1);
+    string name = type_start == string::npos ?
+          s->path : s->path.substr(type_start + 1);
+
+    print_row(out, string(2 * s->depth, ' ') + name, s->durations, total_time);
+  }
+
+  out.flags(flags);
+  out.precision(precision);
+}
@@ -0,0 +1,94 @@
+#ifndef DRUM_DETECTOR_PROFILER_INCLUDED
+#define DRUM_DETECTOR_PROFILER_INCLUDED
+
+#include <marsyas/system/MarSystem.h>
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Histogram of durations with logarithmically spaced bins
+// (8 per octave, so percentiles are accurate to about 4%).
+// Memory use is constant, no matter how many durations are added.
+
+class duration_histogram
+{
+public:
+  duration_histogram();
+
+  void add(double nanoseconds);
+  void merge(const duration_histogram & other);
+
+  uint64_t count() const { return m_count; }
+  double total() const { return m_total; }
+  double max() const { return m_max; }
+  double percentile(double fraction) const;
+
+private:
+  static const int bins_per_octave = 8;
+  static const int octave_count = 44;
+
+  std::vector<uint64_t> m_bins;
+  uint64_t m_count;
+  double m_total;
+  double m_max;
+};
+
+// Records per-tick wall time of every MarSystem in a tree
+// as well as of the whole tick, and the wall time of reporting
+// each onset, which happens outside the ticks.
+
+class tick_profiler
+{
+public:
+  tick_profiler();
+  ~tick_profiler();
+
+  // Observes 'root' and all its descendants.
+  void attach(Marsyas::MarSystem *root);
+  void detach();
+
+  void begin_tick();
+  void end_tick();
+
+  // Onset features are only computed when an onset is reported.
+  void begin_report();
+  void end_report();
+
+  // Adds the measurements of another profiler attached to
+  // an identical MarSystem tree.
+  void merge(const tick_profiler & other);
+
+  void print(std::ostream & out) const;
+
+private:
+  typedef std::chrono::steady_clock clock;
+
+  class stage: public Marsyas::MarSystemObserver
+  {
+  public:
+    stage(Marsyas::MarSystem *system, const std::string & path, int depth):
+      system(system), path(path), depth(depth) {}
+
+    void preProcess(const Marsyas::realvec &);
+    void postProcess(const Marsyas::realvec &);
+
+    Marsyas::MarSystem *system;
+    std::string path;
+    int depth;
+    clock::time_point start;
+    duration_histogram durations;
+  };
+
+  void add_stages(Marsyas::MarSystem *system, const std::string & path, int depth);
+
+  std::vector<stage*> m_stages;
+  duration_histogram m_ticks;
+  clock::time_point m_tick_start;
+  duration_histogram m_reports;
+  clock::time_point m_report_start;
+};
+
+#endif // DRUM_DETECTOR_PROFILER_INCLUDED
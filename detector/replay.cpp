@@ -0,0 +1,92 @@
+#include "replay.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+using namespace Marsyas;
+using namespace std;
+
+feature_replay::feature_replay(const detection_params & params):
+  m_params(params),
+  m_peaks(params)
+{}
+
+feature_replay::~feature_replay()
+{}
+
+void feature_replay::set_params(const detection_params & params)
+{
+  m_params = params;
+  m_peaks.set_params(params);
+}
+
+bool feature_replay::run(const job & j, onset_writer & writer)
+{
+  feature_cache cache;
+  if (!cache.open(j.input))
+    return false;
+
+  run(cache, writer);
+
+  return writer.good();
+}
+
+void feature_replay::run(const feature_cache & cache, onset_sink & sink)
+{
+  find_peaks(cache, m_found);
+
+  for (size_t i = 0; i < m_found.size(); ++i)
+  {
+    const onset_peak & peak = m_found[i];
+
+    if (!m_params.accept(peak.confidence))
+      continue;
+
+    onset o;
+    o.time = peak.time;
+    o.type = m_params.type(peak.centroid);
+    o.strength = peak.strength;
+
+    sink.write(o);
+  }
+}
+
+void feature_replay::find_peaks(const feature_cache & cache, vector<onset_peak> & peaks)
+{
+  peaks.clear();
+
+  m_peaks.reset();
+
+  // The onset function can only be replayed as recorded, with or without
+  // the low band.
+  detection_params params = m_params;
+  params.low_band = cache.band_delay() > 0;
+
+  const feature_frame *frames = cache.frames();
+  uint64_t frame_count = cache.frame_count();
+
+  // Centroid and RMS were recorded with the feature delay of the original run.
+  long feature_shift = (long) cache.feature_delay() - params.feature_delay();
+  long last_frame = (long) frame_count - 1;
+
+  for (uint64_t block = 0; block < frame_count; ++block)
+  {
+    double confidence;
+    if (!m_peaks.process(frames[block].onset_function, confidence))
+      continue;
+
+    long feature_index = std::min(std::max((long) block + feature_shift, 0L), last_frame);
+    const feature_frame & features = frames[feature_index];
+
+    onset_peak peak;
+    peak.block = block;
+    peak.time = params.onset_time((long) block, (long) cache.block_size(), cache.sample_rate());
+    if (params.refine_time && (long) block >= params.look_ahead)
+      peak.time += frames[block - params.look_ahead].attack_offset / cache.sample_rate();
+    peak.confidence = confidence;
+    peak.centroid = features.centroid;
+    peak.strength = features.rms_max;
+
+    peaks.push_back(peak);
+  }
+}
@@ -0,0 +1,60 @@
+#ifndef DRUM_DETECTOR_REPLAY_INCLUDED
+#define DRUM_DETECTOR_REPLAY_INCLUDED
+
+#include "engine.hpp"
+#include "params.hpp"
+#include "features.hpp"
+#include "peak_picker.hpp"
+
+#include <marsyas/system/MarSystem.h>
+
+#include <vector>
+#include <stdint.h>
+
+// A peak of the onset function, before the confidence floor
+// and classification are applied.
+
+struct onset_peak
+{
+  uint64_t block;
+  // Onset time in seconds, back-dated by the latency.
+  double time;
+  double confidence;
+  double centroid;
+  float strength;
+};
+
+// Redoes peak picking and classification from a feature cache written by
+// 'pipeline', using the same "peaks.mrs" script as detector.mrs does.
+// With equal parameters, the onsets are identical to the original run.
+
+class feature_replay: public detection_engine
+{
+public:
+  feature_replay(const detection_params & params = detection_params());
+  ~feature_replay();
+
+  bool valid() const { return m_peaks.valid(); }
+
+  const detection_params & params() const { return m_params; }
+  void set_params(const detection_params & params);
+
+  // The job input is a feature cache file.
+  bool run(const job & j, onset_writer & writer);
+
+  // Same, but from a cache opened by the caller.
+  void run(const feature_cache & cache, onset_sink & sink);
+
+  // Only peak picking, using the peak parameters ('peak_threshold' to 'peak_floor').
+  // Centroid and RMS are taken from the frames they would be taken from
+  // in a run with this look-ahead, whatever the look-ahead of the recording.
+  void find_peaks(const feature_cache & cache, std::vector<onset_peak> & peaks);
+
+private:
+  detection_params m_params;
+
+  peak_picker m_peaks;
+  std::vector<onset_peak> m_found;
+};
+
+#endif // DRUM_DETECTOR_REPLAY_INCLUDED
@@ -0,0 +1,144 @@
+#include "resampler.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+static const double pi = 3.14159265358979323846;
+
+static long greatest_common_divisor(long a, long b)
+{
+  while (b)
+  {
+    long r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+// Floor division, also for negative numerators.
+static int64_t floor_div(int64_t a, int64_t b)
+{
+  int64_t q = a / b;
+  if ((a % b) != 0 && (a < 0))
+    --q;
+  return q;
+}
+
+polyphase_resampler::polyphase_resampler():
+  m_input_rate(0),
+  m_output_rate(0),
+  m_up(1),
+  m_down(1),
+  m_taps(1),
+  m_phases(1, 1.0)
+{}
+
+void polyphase_resampler::design(double input_rate, double output_rate)
+{
+  long in = std::max(1L, (long) floor(input_rate + 0.5));
+  long out = std::max(1L, (long) floor(output_rate + 0.5));
+
+  if (in == m_input_rate && out == m_output_rate)
+    return;
+
+  m_input_rate = in;
+  m_output_rate = out;
+
+  long divisor = greatest_common_divisor(in, out);
+
+  m_up = out / divisor;
+  m_down = in / divisor;
+
+  if (m_up == m_down)
+  {
+    m_taps = 1;
+    m_phases.assign(1, 1.0);
+    return;
+  }
+
+  // Enough taps for a transition band of about 5% of the lower rate.
+  double ratio = std::max(1.0, (double) m_down / m_up);
+  m_taps = 2 * (size_t) ceil(32.0 * ratio);
+
+  // Prototype filter at the upsampled rate, centred on index up * taps / 2.
+  const size_t length = m_up * m_taps;
+  const double center = length / 2;
+  // Cutoff below the lower Nyquist frequency, in cycles per upsampled sample.
+  const double cutoff = 0.45 * std::min(1.0, (double) m_up / m_down) / m_up;
+
+  vector<double> prototype(length);
+  for (size_t j = 0; j < length; ++j)
+  {
+    double x = j - center;
+    double sinc = x == 0.0 ? 1.0 : sin(2.0 * pi * cutoff * x) / (2.0 * pi * cutoff * x);
+    double phase = 2.0 * pi * j / length;
+    double window = 0.42 - 0.5 * cos(phase) + 0.08 * cos(2.0 * phase);
+    prototype[j] = sinc * window;
+  }
+
+  // Output sample n uses phase p = (n * down + center) % up, and the
+  // input samples up to i = (n * down + center) / up, with coefficient
+  // prototype[p + k * up] for input sample i - k.
+  // Each phase is normalized to unity gain at DC.
+  m_phases.resize(length);
+  for (long p = 0; p < m_up; ++p)
+  {
+    double *phase = &m_phases[p * m_taps];
+    double sum = 0.0;
+    for (size_t k = 0; k < m_taps; ++k)
+    {
+      phase[m_taps - 1 - k] = prototype[p + k * m_up];
+      sum += prototype[p + k * m_up];
+    }
+    for (size_t k = 0; k < m_taps; ++k)
+      phase[k] /= sum;
+  }
+}
+
+int64_t polyphase_resampler::output_count(int64_t input_count) const
+{
+  return (input_count * m_up + m_down - 1) / m_down;
+}
+
+int64_t polyphase_resampler::last_input(int64_t n) const
+{
+  int64_t center = (int64_t) (m_up * m_taps / 2);
+  return floor_div(n * m_down + center, m_up);
+}
+
+int64_t polyphase_resampler::input_begin(int64_t first) const
+{
+  return last_input(first) - (int64_t) m_taps + 1;
+}
+
+int64_t polyphase_resampler::input_end(int64_t end) const
+{
+  return last_input(end - 1) + 1;
+}
+
+void polyphase_resampler::process(const double *input, int64_t input_first,
+                                  int64_t first, size_t count,
+                                  double *output, size_t stride) const
+{
+  const int64_t center = (int64_t) (m_up * m_taps / 2);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    int64_t n = first + (int64_t) i;
+    int64_t u = n * m_down + center;
+    int64_t last = floor_div(u, m_up);
+    int64_t phase = u - last * m_up;
+
+    const double *h = &m_phases[phase * m_taps];
+    const double *x = input + (last - (int64_t) m_taps + 1 - input_first) * stride;
+
+    double sum = 0.0;
+    for (size_t k = 0; k < m_taps; ++k)
+      sum += h[k] * x[k * stride];
+
+    output[i * stride] = sum;
+  }
+}
@@ -0,0 +1,56 @@
+#ifndef DRUM_DETECTOR_RESAMPLER_INCLUDED
+#define DRUM_DETECTOR_RESAMPLER_INCLUDED
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+// Polyphase filter for resampling by a rational factor up / down,
+// with a Blackman-windowed sinc low-pass below both Nyquist frequencies.
+//
+// Output sample n is at the same time as input sample n * down / up:
+// the filter delay is compensated, so the output needs input from
+// slightly ahead of that point.
+
+class polyphase_resampler
+{
+public:
+  polyphase_resampler();
+
+  // Sample rates in Hz, rounded to integers.
+  // Does nothing if the rates are the same as last time.
+  void design(double input_rate, double output_rate);
+
+  long up() const { return m_up; }
+  long down() const { return m_down; }
+
+  // Number of output samples for 'input_count' input samples.
+  int64_t output_count(int64_t input_count) const;
+
+  // Input samples needed for output samples [first, first + count):
+  // [input_begin(first), input_end(first + count)).
+  int64_t input_begin(int64_t first) const;
+  int64_t input_end(int64_t end) const;
+
+  // Computes output samples [first, first + count) into 'output', from
+  // 'input' holding input samples from index 'input_first' on.
+  // Consecutive samples are 'stride' values apart in both buffers.
+  void process(const double *input, int64_t input_first,
+               int64_t first, size_t count,
+               double *output, size_t stride) const;
+
+private:
+  // Index of the last input sample contributing to output sample n.
+  int64_t last_input(int64_t n) const;
+
+  long m_input_rate;
+  long m_output_rate;
+  long m_up;
+  long m_down;
+  size_t m_taps;
+  // Filter coefficients ordered by phase, each phase ordered by
+  // ascending input index: m_phases[phase * m_taps + k].
+  std::vector<double> m_phases;
+};
+
+#endif // DRUM_DETECTOR_RESAMPLER_INCLUDED
@@ -0,0 +1,62 @@
+#include "silence_gate.hpp"
+
+using namespace std;
+
+namespace Marsyas {
+
+SilenceGate::SilenceGate(string name):
+  Series(name),
+  m_open(true),
+  m_skipped(0)
+{
+  type_ = "SilenceGate";
+  addControls();
+}
+
+SilenceGate::SilenceGate(const SilenceGate & other):
+  Series(other),
+  m_open(true),
+  m_skipped(0)
+{
+  m_floor = getctrl("mrs_real/floor");
+  m_reset = getctrl("mrs_bool/reset");
+}
+
+void SilenceGate::addControls()
+{
+  addctrl("mrs_real/floor", 0.0, m_floor);
+  addctrl("mrs_bool/reset", false, m_reset);
+}
+
+void SilenceGate::myProcess(realvec & in, realvec & out)
+{
+  // Not a state control: Series handles all updates.
+  if (m_reset->to<mrs_bool>())
+  {
+    m_open = true;
+    m_skipped = 0;
+    m_reset->setValue(false, NOUPDATE);
+  }
+
+  // Compare the sum of squares, saving the square root.
+  const mrs_real *data = in.getData();
+  mrs_natural count = inObservations_ * inSamples_;
+  mrs_real sum = 0.0;
+  for (mrs_natural i = 0; i < count; ++i)
+    sum += data[i] * data[i];
+
+  mrs_real floor = m_floor->to<mrs_real>();
+  bool silent = !(sum > floor * floor * count);
+
+  if (!silent || m_open)
+  {
+    m_open = !silent;
+    Series::myProcess(in, out);
+    return;
+  }
+
+  out.setval(0.0);
+  ++m_skipped;
+}
+
+} // namespace Marsyas
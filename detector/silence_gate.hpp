@@ -0,0 +1,41 @@
+#ifndef DRUM_DETECTOR_SILENCE_GATE_INCLUDED
+#define DRUM_DETECTOR_SILENCE_GATE_INCLUDED
+
+#include <marsyas/marsystems/Series.h>
+
+namespace Marsyas {
+
+// Series that skips processing its children while the input is silent,
+// i.e. its RMS over all values is at most 'floor', outputting zeros instead.
+// The first silent tick after a non-silent one is still processed, so that
+// children with state (e.g. RectifiedFlux) continue from a silent frame.
+// With 'floor' = 0 only digital silence is skipped, which leaves the output
+// of a spectral flux path unchanged.
+// Setting 'reset' clears the skipped tick count.
+
+class SilenceGate: public Series
+{
+public:
+  SilenceGate(std::string name);
+  SilenceGate(const SilenceGate & other);
+
+  MarSystem *clone() const { return new SilenceGate(*this); }
+
+  void myProcess(realvec & in, realvec & out);
+
+  // Ticks skipped since the last reset.
+  mrs_natural skippedCount() const { return m_skipped; }
+
+private:
+  void addControls();
+
+  MarControlPtr m_floor;
+  MarControlPtr m_reset;
+
+  bool m_open;
+  mrs_natural m_skipped;
+};
+
+} // namespace Marsyas
+
+#endif // DRUM_DETECTOR_SILENCE_GATE_INCLUDED
@@ -0,0 +1,484 @@
+#include "scripts.hpp"
+#include "replay.hpp"
+#include "features.hpp"
+#include "batch.hpp"
+#include "work_queue.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+
+//FIXME: Only on POSIX:
+#include <unistd.h>
+
+// The performance analysis sources expect namespace std in use.
+using namespace std;
+
+#include "object.h"
+#include "app.h"
+#include "paa.h"
+
+// Onset tolerance in ms that run/evaluate.sh scores detector runs with.
+static const float evaluation_onset_tolerance = 40.0f;
+
+static void print_usage()
+{
+  cerr << "Usage:" << endl
+       << "  sweep -m <map file> [options] <features dir> <reference dir>" << endl
+       << endl
+       << "Evaluates every combination of the given parameter ranges on all" << endl
+       << ".features files under <features dir>, against the .mid file at the" << endl
+       << "same relative path under <reference dir>, using the same matching" << endl
+       << "as the 'paa' program. Results are sorted by the fraction of events" << endl
+       << "detected with correct type among all reference and ghost events." << endl
+       << endl
+       << "A range is either a single value or <from>:<to>:<step>." << endl
+       << "Options:" << endl
+       << "  -t <range>  Peak threshold (default: 1.7)." << endl
+       << "  -a <range>  Peak look-ahead in frames (default: 4)." << endl
+       << "  -k <range>  Minimum peak confidence (default: 0.1)." << endl
+       << "  -l <range>  Low centroid boundary (default: 0.04)." << endl
+       << "  -u <range>  High centroid boundary (default: 0.3)." << endl
+       << "  -o <ms>     Onset tolerance (default: 40, as in run/evaluate.sh)." << endl
+       << "  -j <count>  Number of worker threads (default: 1)." << endl
+       << "  -r <file>   Write results to file instead of stdout." << endl;
+}
+
+static bool parse_range(const char *text, vector<double> & values)
+{
+  double from, to, step;
+  char tail;
+
+  values.clear();
+
+  if (sscanf(text, "%lf:%lf:%lf%c", &from, &to, &step, &tail) == 3)
+  {
+    if (!(step > 0.0) || to < from)
+      return false;
+
+    for (int i = 0; from + i * step <= to + step * 1e-6; ++i)
+      values.push_back(from + i * step);
+
+    return true;
+  }
+
+  if (sscanf(text, "%lf%c", &from, &tail) == 1)
+  {
+    values.push_back(from);
+    return true;
+  }
+
+  return false;
+}
+
+// All parameter combinations. Peak picking only depends on the 'peak'
+// parameters, so it is done once per peak combination, and all the
+// 'class' combinations (confidence floor, centroid boundaries)
+// are evaluated on the same peaks.
+
+struct sweep_grid
+{
+  vector<detection_params> peak_params;
+  vector<detection_params> class_params;
+
+  size_t size() const { return peak_params.size() * class_params.size(); }
+
+  detection_params params(size_t peak_index, size_t class_index) const
+  {
+    detection_params p = class_params[class_index];
+    p.peak_threshold = peak_params[peak_index].peak_threshold;
+    p.look_ahead = peak_params[peak_index].look_ahead;
+    return p;
+  }
+};
+
+struct sweep_file
+{
+  string features;
+  string reference;
+  feature_cache cache;
+  vector<Paa::trEvent> events;
+};
+
+static void add_counts(Paa::event_counts & total, const Paa::event_counts & counts)
+{
+  total.detected += counts.detected;
+  total.misdetected += counts.misdetected;
+  total.missed += counts.missed;
+  total.ghost += counts.ghost;
+}
+
+static double score(const Paa::event_counts & counts)
+{
+  uint32_t total = counts.detected + counts.misdetected + counts.missed + counts.ghost;
+  return total ? (double) counts.detected / total : 0.0;
+}
+
+static void run_worker(int worker, feature_replay *replay,
+                       const sweep_grid & grid,
+                       const vector<sweep_file*> & files,
+                       float onset_tolerance,
+                       work_queue & queue,
+                       vector<Paa::event_counts> & totals)
+{
+  vector<onset_peak> peaks;
+  vector<Paa::trEvent> reference;
+  vector<Paa::trEvent> measure;
+
+  size_t unit;
+  while (queue.pop(worker, unit))
+  {
+    size_t peak_index = unit / files.size();
+    const sweep_file & file = *files[unit % files.size()];
+
+    replay->set_params(grid.peak_params[peak_index]);
+    replay->find_peaks(file.cache, peaks);
+
+    for (size_t class_index = 0; class_index < grid.class_params.size(); ++class_index)
+    {
+      detection_params params = grid.params(peak_index, class_index);
+
+      // Same as writing onsets and reading them back with Paa::acquireEvents.
+      measure.clear();
+      for (size_t i = 0; i < peaks.size(); ++i)
+      {
+        const onset_peak & peak = peaks[i];
+
+        if (!params.accept(peak.confidence) || !(peak.strength > 0.0f))
+          continue;
+
+        Paa::trEvent event;
+        event.bMatch = false;
+        event.uReference = 0;
+        event.fTimestamp = (float) peak.time;
+        event.uType = params.type(peak.centroid);
+        event.original_type = event.uType;
+        event.fStrength = peak.strength;
+
+        measure.push_back(event);
+      }
+
+      reference = file.events;
+
+      Paa::matchEvents(reference, measure, onset_tolerance);
+
+      Paa::event_counts counts;
+      Paa::countEvents(reference, measure, counts, 0);
+
+      add_counts(totals[peak_index * grid.class_params.size() + class_index], counts);
+    }
+  }
+}
+
+struct sweep_result
+{
+  detection_params params;
+  Paa::event_counts counts;
+};
+
+static bool better_result(const sweep_result & a, const sweep_result & b)
+{
+  return score(a.counts) > score(b.counts);
+}
+
+static void print_results(ostream & out, const vector<sweep_result> & results,
+                          float onset_tolerance)
+{
+  out << "# onset tolerance: " << onset_tolerance << " ms" << endl;
+  out << "peak_threshold,look_ahead,min_confidence,low_centroid,high_centroid,"
+      << "detected,misdetected,missed,ghost,"
+      << "onset_accuracy,onset_precision,onset_recall,type_accuracy,score"
+      << endl;
+
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const sweep_result & r = results[i];
+
+    Paa::statistics stats;
+    Paa::computeStatistics(r.counts, stats);
+
+    out << r.params.peak_threshold << ','
+        << r.params.look_ahead << ','
+        << r.params.min_confidence << ','
+        << r.params.low_centroid << ','
+        << r.params.high_centroid << ','
+        << r.counts.detected << ','
+        << r.counts.misdetected << ','
+        << r.counts.missed << ','
+        << r.counts.ghost << ','
+        << stats.onset_accuracy << ','
+        << stats.onset_precision << ','
+        << stats.onset_recall << ','
+        << stats.type_accuracy << ','
+        << score(r.counts)
+        << endl;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  detection_params defaults;
+
+  vector<double> thresholds(1, defaults.peak_threshold);
+  vector<double> look_aheads(1, defaults.look_ahead);
+  vector<double> confidences(1, defaults.min_confidence);
+  vector<double> low_centroids(1, defaults.low_centroid);
+  vector<double> high_centroids(1, defaults.high_centroid);
+
+  string map_filename;
+  string result_filename;
+  float onset_tolerance = evaluation_onset_tolerance;
+  int worker_count = 1;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "t:a:k:l:u:m:o:j:r:")) != -1)
+  {
+    bool ok = true;
+
+    switch (opt)
+    {
+    case 't':
+      ok = parse_range(optarg, thresholds);
+      break;
+    case 'a':
+      ok = parse_range(optarg, look_aheads);
+      break;
+    case 'k':
+      ok = parse_range(optarg, confidences);
+      break;
+    case 'l':
+      ok = parse_range(optarg, low_centroids);
+      break;
+    case 'u':
+      ok = parse_range(optarg, high_centroids);
+      break;
+    case 'm':
+      map_filename = optarg;
+      break;
+    case 'o':
+      onset_tolerance = (float) atof(optarg);
+      break;
+    case 'j':
+      worker_count = atoi(optarg);
+      ok = worker_count > 0;
+      break;
+    case 'r':
+      result_filename = optarg;
+      break;
+    default:
+      print_usage();
+      return 1;
+    }
+
+    if (!ok)
+    {
+      cerr << "Invalid value for option -" << (char) opt << ": " << optarg << endl;
+      return 1;
+    }
+  }
+
+  if (map_filename.empty() || argc - optind != 2)
+  {
+    print_usage();
+    return 1;
+  }
+
+  string features_dir = argv[optind];
+  string reference_dir = argv[optind+1];
+
+  // Parameter grid
+
+  sweep_grid grid;
+
+  for (size_t t = 0; t < thresholds.size(); ++t)
+  {
+    for (size_t a = 0; a < look_aheads.size(); ++a)
+    {
+      detection_params p;
+      p.peak_threshold = thresholds[t];
+      p.look_ahead = (int) look_aheads[a];
+      if (p.look_ahead < 0)
+      {
+        cerr << "Invalid look-ahead: " << look_aheads[a] << endl;
+        return 1;
+      }
+      // As the detector requires; the peak picker would otherwise widen
+      // its window, and the result would not be that of these parameters.
+      if (p.peak_window < 2 * p.look_ahead + 1)
+      {
+        cerr << "Skipping threshold " << p.peak_threshold
+             << ", look-ahead " << p.look_ahead
+             << ": Peak window (" << p.peak_window
+             << ") must be at least 2 * look-ahead + 1 frames." << endl;
+        continue;
+      }
+      grid.peak_params.push_back(p);
+    }
+  }
+
+  if (grid.peak_params.empty())
+  {
+    cerr << "No valid peak parameter combinations." << endl;
+    return 1;
+  }
+
+  for (size_t k = 0; k < confidences.size(); ++k)
+  {
+    for (size_t l = 0; l < low_centroids.size(); ++l)
+    {
+      for (size_t u = 0; u < high_centroids.size(); ++u)
+      {
+        detection_params p;
+        p.min_confidence = confidences[k];
+        p.low_centroid = low_centroids[l];
+        p.high_centroid = high_centroids[u];
+        grid.class_params.push_back(p);
+      }
+    }
+  }
+
+  // Input files
+
+  Paa::type_map map;
+  if (!Paa::acquireMap(map_filename, map.mappings))
+  {
+    cerr << "Failed to read map file: " << map_filename << endl;
+    return 1;
+  }
+
+  vector<job> jobs;
+  if (!scan_directory(features_dir, reference_dir, jobs, ".features"))
+    return 1;
+
+  vector<sweep_file*> files;
+
+  for (size_t i = 0; i < jobs.size(); ++i)
+  {
+    sweep_file *file = new sweep_file;
+    file->features = jobs[i].input;
+    file->reference = replace_extension(jobs[i].output, ".mid");
+
+    bool ok = file->cache.open(file->features);
+
+    if (ok)
+    {
+      try {
+        Paa::acquireEvents(file->reference, file->events, map, true);
+      }
+      catch (std::exception & e)
+      {
+        cerr << "Can not read reference file: " << file->reference
+             << " (" << e.what() << ")" << endl;
+        ok = false;
+      }
+    }
+
+    if (ok)
+    {
+      files.push_back(file);
+    }
+    else
+    {
+      cerr << "Skipping: " << file->features << endl;
+      delete file;
+    }
+  }
+
+  if (files.empty())
+  {
+    cerr << "No files to evaluate." << endl;
+    return 1;
+  }
+
+  cerr << "Evaluating " << grid.size() << " parameter combinations"
+       << " on " << files.size() << " files." << endl;
+
+  // Evaluation
+
+  size_t unit_count = grid.peak_params.size() * files.size();
+
+  if (worker_count > (int) unit_count)
+    worker_count = (int) unit_count;
+
+  detector::registerScripts();
+
+  Paa::event_counts zero_counts = { 0, 0, 0, 0 };
+
+  vector<feature_replay*> replays;
+  vector< vector<Paa::event_counts> > worker_totals;
+  for (int w = 0; w < worker_count; ++w)
+  {
+    feature_replay *replay = new feature_replay;
+    replays.push_back(replay);
+    if (!replay->valid())
+    {
+      for (size_t i = 0; i < replays.size(); ++i)
+        delete replays[i];
+      return 1;
+    }
+    worker_totals.push_back(vector<Paa::event_counts>(grid.size(), zero_counts));
+  }
+
+  work_queue queue(unit_count, worker_count);
+
+  vector<thread> workers;
+  for (int w = 0; w < worker_count; ++w)
+  {
+    workers.push_back(thread(run_worker, w, replays[w],
+                             std::cref(grid), std::cref(files), onset_tolerance,
+                             std::ref(queue), std::ref(worker_totals[w])));
+  }
+  for (int w = 0; w < worker_count; ++w)
+    workers[w].join();
+
+  for (size_t i = 0; i < replays.size(); ++i)
+    delete replays[i];
+  for (size_t i = 0; i < files.size(); ++i)
+    delete files[i];
+
+  // Results
+
+  vector<sweep_result> results;
+  for (size_t p = 0; p < grid.peak_params.size(); ++p)
+  {
+    for (size_t c = 0; c < grid.class_params.size(); ++c)
+    {
+      size_t index = p * grid.class_params.size() + c;
+
+      sweep_result r;
+      r.params = grid.params(p, c);
+      r.counts = zero_counts;
+      for (int w = 0; w < worker_count; ++w)
+        add_counts(r.counts, worker_totals[w][index]);
+
+      results.push_back(r);
+    }
+  }
+
+  stable_sort(results.begin(), results.end(), better_result);
+
+  if (result_filename.empty())
+  {
+    print_results(cout, results, onset_tolerance);
+  }
+  else
+  {
+    ofstream result_file(result_filename.c_str());
+    if (!result_file.is_open())
+    {
+      cerr << "Failed to open output file for writing: " << result_filename << endl;
+      return 1;
+    }
+    print_results(result_file, results, onset_tolerance);
+  }
+
+  return 0;
+}
@@ -0,0 +1,492 @@
+#include "wav_source.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+
+//FIXME: Only on POSIX:
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+using namespace std;
+
+namespace Marsyas {
+
+static const uint16_t format_pcm = 0x0001;
+static const uint16_t format_float = 0x0003;
+static const uint16_t format_extensible = 0xFFFE;
+
+// WAV files are little-endian, regardless of the host.
+
+static inline uint16_t read_u16(const unsigned char *p)
+{
+  return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static inline uint32_t read_u32(const unsigned char *p)
+{
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+      ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+// Sample decoders, each returning a value in [-1, 1).
+
+struct decode_uint8
+{
+  static const size_t size = 1;
+  static mrs_real get(const unsigned char *p) { return (p[0] - 128) * (1.0 / 128.0); }
+};
+
+struct decode_int16
+{
+  static const size_t size = 2;
+  static mrs_real get(const unsigned char *p)
+  {
+    return (int16_t) read_u16(p) * (1.0 / 32768.0);
+  }
+};
+
+struct decode_int24
+{
+  static const size_t size = 3;
+  static mrs_real get(const unsigned char *p)
+  {
+    // Place in the top bytes of a 32 bit word, for sign extension.
+    int32_t v = (int32_t) (((uint32_t) p[0] << 8) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 24));
+    return v * (1.0 / 2147483648.0);
+  }
+};
+
+struct decode_int32
+{
+  static const size_t size = 4;
+  static mrs_real get(const unsigned char *p)
+  {
+    return (int32_t) read_u32(p) * (1.0 / 2147483648.0);
+  }
+};
+
+struct decode_float32
+{
+  static const size_t size = 4;
+  static mrs_real get(const unsigned char *p)
+  {
+    uint32_t bits = read_u32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+};
+
+// Converts 'frame_count' frames into consecutive columns of a realvec
+// starting at 'dst', in a single pass over the source. realvec stores each
+// column (sample) contiguously, so interleaved frames map one-to-one onto
+// the output when not mixing.
+template <typename D>
+static void convert(const unsigned char *src, size_t frame_count,
+                    mrs_natural channels, bool mix, mrs_real *dst)
+{
+  if (channels == 1 || !mix)
+  {
+    const size_t count = frame_count * channels;
+    for (size_t i = 0; i < count; ++i)
+      dst[i] = D::get(src + i * D::size);
+  }
+  else
+  {
+    const mrs_real scale = 1.0 / channels;
+    for (size_t t = 0; t < frame_count; ++t)
+    {
+      mrs_real sum = 0.0;
+      for (mrs_natural c = 0; c < channels; ++c, src += D::size)
+        sum += D::get(src);
+      dst[t] = sum * scale;
+    }
+  }
+}
+
+// Converts one channel of 'frame_count' frames into 'dst'.
+template <typename D>
+static void extract(const unsigned char *src, size_t frame_count,
+                    mrs_natural channels, mrs_natural channel, mrs_real *dst)
+{
+  const size_t stride = channels * D::size;
+
+  src += channel * D::size;
+
+  for (size_t t = 0; t < frame_count; ++t, src += stride)
+    dst[t] = D::get(src);
+}
+
+template <typename D>
+static void decode(const unsigned char *src, size_t frame_count,
+                   mrs_natural channels, mrs_natural channel, bool mix,
+                   mrs_real *dst)
+{
+  if (channel >= 0)
+    extract<D>(src, frame_count, channels, channel, dst);
+  else
+    convert<D>(src, frame_count, channels, mix, dst);
+}
+
+WavSource::WavSource(string name):
+  MarSystem("WavSource", name),
+  m_map(0),
+  m_map_size(0),
+  m_samples(0),
+  m_frame_count(0),
+  m_channels(1),
+  m_sample_rate(0.0),
+  m_encoding(int16_pcm),
+  m_frame_bytes(2),
+  m_position(0),
+  m_length(0),
+  m_resample(false)
+{
+  addControls();
+}
+
+WavSource::WavSource(const WavSource & other):
+  MarSystem(other),
+  m_map(0),
+  m_map_size(0),
+  m_samples(0),
+  m_frame_count(0),
+  m_channels(1),
+  m_sample_rate(0.0),
+  m_encoding(int16_pcm),
+  m_frame_bytes(2),
+  m_position(0),
+  m_length(0),
+  m_resample(false)
+{
+  m_filename = getctrl("mrs_string/filename");
+  m_mix = getctrl("mrs_bool/mixToMono");
+  m_channel = getctrl("mrs_natural/channel");
+  m_analysis_rate = getctrl("mrs_real/analysisRate");
+  m_has_data = getctrl("mrs_bool/hasData");
+  m_reset = getctrl("mrs_bool/reset");
+}
+
+WavSource::~WavSource()
+{
+  close();
+}
+
+void WavSource::addControls()
+{
+  addctrl("mrs_string/filename", mrs_string(), m_filename);
+  setctrlState("mrs_string/filename", true);
+  addctrl("mrs_bool/mixToMono", true, m_mix);
+  setctrlState("mrs_bool/mixToMono", true);
+  addctrl("mrs_natural/channel", (mrs_natural) -1, m_channel);
+  setctrlState("mrs_natural/channel", true);
+  addctrl("mrs_real/analysisRate", (mrs_real) 0.0, m_analysis_rate);
+  setctrlState("mrs_real/analysisRate", true);
+  addctrl("mrs_bool/hasData", false, m_has_data);
+  addctrl("mrs_bool/reset", false, m_reset);
+  setctrlState("mrs_bool/reset", true);
+}
+
+mrs_natural WavSource::channelCount(const string & filename)
+{
+  WavSource probe("probe");
+  if (!probe.open(filename))
+    return 0;
+  return probe.m_channels;
+}
+
+bool WavSource::open(const string & filename)
+{
+  close();
+
+  m_open_filename = filename;
+
+  if (filename.empty())
+    return false;
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+  {
+    cerr << "WavSource: Error(" << errno << ") opening " << filename << endl;
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < 12)
+  {
+    cerr << "WavSource: Not a WAV file: " << filename << endl;
+    ::close(fd);
+    return false;
+  }
+
+  void *data = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (data == MAP_FAILED)
+  {
+    cerr << "WavSource: Error(" << errno << ") mapping " << filename << endl;
+    return false;
+  }
+
+  m_map = data;
+  m_map_size = info.st_size;
+
+  if (!parse())
+  {
+    cerr << "WavSource: Unsupported or invalid WAV file: " << filename << endl;
+    close();
+    return false;
+  }
+
+  madvise(m_map, m_map_size, MADV_SEQUENTIAL);
+
+  return true;
+}
+
+bool WavSource::parse()
+{
+  const unsigned char *data = static_cast<const unsigned char*>(m_map);
+  const unsigned char *end = data + m_map_size;
+
+  if (memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0)
+    return false;
+
+  bool have_format = false;
+  uint16_t format = 0;
+  uint16_t channels = 0;
+  uint32_t sample_rate = 0;
+  uint16_t block_align = 0;
+  uint16_t bits = 0;
+
+  const unsigned char *chunk = data + 12;
+
+  while (end - chunk >= 8)
+  {
+    const unsigned char *body = chunk + 8;
+    size_t size = read_u32(chunk + 4);
+    size_t available = end - body;
+
+    if (memcmp(chunk, "fmt ", 4) == 0)
+    {
+      if (size < 16 || size > available)
+        return false;
+
+      format = read_u16(body);
+      channels = read_u16(body + 2);
+      sample_rate = read_u32(body + 4);
+      block_align = read_u16(body + 12);
+      bits = read_u16(body + 14);
+
+      if (format == format_extensible)
+      {
+        if (size < 40)
+          return false;
+        // First two bytes of the sub-format GUID are the format tag.
+        format = read_u16(body + 24);
+      }
+
+      have_format = true;
+    }
+    else if (memcmp(chunk, "data", 4) == 0)
+    {
+      if (!have_format)
+        return false;
+
+      // Files written by streaming tools may leave the size unset.
+      size = std::min(size, available);
+
+      m_samples = body;
+      m_frame_count = block_align ? size / block_align : 0;
+      break;
+    }
+
+    // Chunks are padded to an even size.
+    size_t step = size + (size & 1);
+    if (step > available)
+      break;
+    chunk = body + step;
+  }
+
+  if (!m_samples || !channels || !sample_rate)
+    return false;
+
+  if (format == format_pcm && bits == 8)
+    m_encoding = uint8_pcm;
+  else if (format == format_pcm && bits == 16)
+    m_encoding = int16_pcm;
+  else if (format == format_pcm && bits == 24)
+    m_encoding = int24_pcm;
+  else if (format == format_pcm && bits == 32)
+    m_encoding = int32_pcm;
+  else if (format == format_float && bits == 32)
+    m_encoding = float32_pcm;
+  else
+    return false;
+
+  m_frame_bytes = (size_t) channels * (bits / 8);
+  if (block_align != m_frame_bytes)
+    return false;
+
+  m_channels = channels;
+  m_sample_rate = sample_rate;
+  m_position = 0;
+
+  return true;
+}
+
+void WavSource::close()
+{
+  if (m_map)
+    munmap(m_map, m_map_size);
+  m_map = 0;
+  m_map_size = 0;
+  m_samples = 0;
+  m_frame_count = 0;
+  m_channels = 1;
+  m_sample_rate = 0.0;
+  m_position = 0;
+  m_length = 0;
+}
+
+void WavSource::myUpdate(MarControlPtr sender)
+{
+  (void) sender;
+
+  const mrs_string & filename = m_filename->to<mrs_string>();
+  if (filename != m_open_filename)
+    open(filename);
+
+  if (m_reset->to<mrs_bool>())
+  {
+    m_position = 0;
+    m_reset->setValue(false, NOUPDATE);
+  }
+
+  bool mix = m_mix->to<mrs_bool>();
+  mrs_natural channel = m_channel->to<mrs_natural>();
+
+  if (channel >= m_channels && m_map)
+  {
+    cerr << "WavSource: No channel " << channel << " in " << m_open_filename
+         << " (" << m_channels << " channels). Outputting silence." << endl;
+  }
+
+  bool single = mix || channel >= 0;
+  mrs_natural observations = single ? (mrs_natural) 1 : m_channels;
+  mrs_natural samples = ctrl_inSamples_->to<mrs_natural>();
+
+  mrs_real analysis_rate = m_analysis_rate->to<mrs_real>();
+  mrs_real rate = m_sample_rate;
+
+  m_resample = false;
+  m_length = m_frame_count;
+
+  if (m_map && analysis_rate > 0.0)
+  {
+    m_resampler.design(m_sample_rate, analysis_rate);
+    if (m_resampler.up() != m_resampler.down())
+    {
+      m_resample = true;
+      m_length = m_resampler.output_count(m_frame_count);
+      rate = analysis_rate;
+
+      // Largest input span of one block.
+      size_t span = (size_t) (m_resampler.input_end(samples) - m_resampler.input_begin(0)) + 2;
+      if (m_decoded.getRows() != observations || (size_t) m_decoded.getCols() < span)
+        m_decoded.create(observations, span);
+    }
+  }
+
+  m_has_data->setValue(m_position < m_length, NOUPDATE);
+
+  ctrl_onObservations_->setValue(observations, NOUPDATE);
+  ctrl_onSamples_->setValue(samples, NOUPDATE);
+  ctrl_osrate_->setValue(rate, NOUPDATE);
+}
+
+void WavSource::decodeFrames(size_t first, size_t count, mrs_real *dst)
+{
+  const unsigned char *src = m_samples + first * m_frame_bytes;
+  bool mix = m_mix->to<mrs_bool>();
+  mrs_natural channel = m_channel->to<mrs_natural>();
+
+  switch (m_encoding)
+  {
+  case uint8_pcm:
+    decode<decode_uint8>(src, count, m_channels, channel, mix, dst);
+    break;
+  case int16_pcm:
+    decode<decode_int16>(src, count, m_channels, channel, mix, dst);
+    break;
+  case int24_pcm:
+    decode<decode_int24>(src, count, m_channels, channel, mix, dst);
+    break;
+  case int32_pcm:
+    decode<decode_int32>(src, count, m_channels, channel, mix, dst);
+    break;
+  case float32_pcm:
+    decode<decode_float32>(src, count, m_channels, channel, mix, dst);
+    break;
+  }
+}
+
+void WavSource::resample(size_t count, realvec & out)
+{
+  int64_t first = m_resampler.input_begin(m_position);
+  int64_t end = m_resampler.input_end(m_position + count);
+
+  // Input before the start and after the end of the file is silence.
+  int64_t valid_first = std::max(first, (int64_t) 0);
+  int64_t valid_end = std::min(end, (int64_t) m_frame_count);
+
+  if (valid_first != first || valid_end != end)
+    m_decoded.setval(0.0);
+
+  if (valid_end > valid_first)
+  {
+    decodeFrames((size_t) valid_first, (size_t) (valid_end - valid_first),
+                 m_decoded.getData() + (valid_first - first) * onObservations_);
+  }
+
+  for (mrs_natural o = 0; o < onObservations_; ++o)
+  {
+    m_resampler.process(m_decoded.getData() + o, first,
+                        (int64_t) m_position, count,
+                        out.getData() + o, (size_t) onObservations_);
+  }
+}
+
+void WavSource::myProcess(realvec & in, realvec & out)
+{
+  (void) in;
+
+  size_t remaining = m_length - m_position;
+  size_t count = std::min((size_t) onSamples_, remaining);
+
+  if (count < (size_t) onSamples_)
+    out.setval(0.0);
+
+  if (!count)
+    return;
+
+  mrs_natural channel = m_channel->to<mrs_natural>();
+
+  if (channel >= m_channels)
+    out.setval(0.0);
+  else if (m_resample)
+    resample(count, out);
+  else
+    decodeFrames(m_position, count, out.getData());
+
+  m_position += count;
+
+  if (m_position >= m_length)
+    m_has_data->setValue(false);
+}
+
+} // namespace Marsyas
@@ -0,0 +1,93 @@
+#ifndef DRUM_DETECTOR_WAV_SOURCE_INCLUDED
+#define DRUM_DETECTOR_WAV_SOURCE_INCLUDED
+
+#include "resampler.hpp"
+
+#include <marsyas/system/MarSystem.h>
+
+#include <string>
+#include <cstddef>
+
+namespace Marsyas {
+
+// Reads PCM WAV files through a memory map, converting samples straight
+// from the mapped pages into the output. Replaces SoundFileSource
+// (+ MixToMono) for the formats in our corpus.
+// Supported formats: 8, 16, 24 and 32 bit integer and 32 bit float PCM,
+// also in WAVE_FORMAT_EXTENSIBLE files.
+// When 'channel' is a channel index, only that channel is output.
+// Otherwise, when 'mixToMono' is true (default), channels are averaged
+// into one observation, else there is one observation per channel.
+// Only the output channels are converted, so several WavSources can
+// share the work of decoding one file, each reading from the same pages.
+// When 'analysisRate' is above 0 and differs from the file's sample rate,
+// the output is resampled to it (see polyphase_resampler). Output sample n
+// is at time n / analysisRate, like input sample n at the file's rate.
+// 'osrate' is the output sample rate, or 0 when no file is open.
+// 'hasData' turns false when the last samples have been output.
+// Setting 'reset' rewinds to the start of the file.
+
+class WavSource: public MarSystem
+{
+public:
+  WavSource(std::string name);
+  WavSource(const WavSource & other);
+  ~WavSource();
+
+  MarSystem *clone() const { return new WavSource(*this); }
+
+  // Number of channels of a file WavSource can read, or 0.
+  static mrs_natural channelCount(const std::string & filename);
+
+private:
+  enum encoding
+  {
+    uint8_pcm,
+    int16_pcm,
+    int24_pcm,
+    int32_pcm,
+    float32_pcm
+  };
+
+  void addControls();
+  void myUpdate(MarControlPtr sender);
+  void myProcess(realvec & in, realvec & out);
+
+  bool open(const std::string & filename);
+  bool parse();
+  void close();
+  void decodeFrames(size_t first, size_t count, mrs_real *dst);
+  void resample(size_t count, realvec & out);
+
+  MarControlPtr m_filename;
+  MarControlPtr m_mix;
+  MarControlPtr m_channel;
+  MarControlPtr m_analysis_rate;
+  MarControlPtr m_has_data;
+  MarControlPtr m_reset;
+
+  std::string m_open_filename;
+  void *m_map;
+  size_t m_map_size;
+
+  // Format of the open file.
+  const unsigned char *m_samples;
+  size_t m_frame_count;
+  mrs_natural m_channels;
+  mrs_real m_sample_rate;
+  encoding m_encoding;
+  size_t m_frame_bytes;
+
+  // Output position and length, in output samples.
+  size_t m_position;
+  size_t m_length;
+
+  bool m_resample;
+  polyphase_resampler m_resampler;
+  // Input decoded for one block when resampling.
+  realvec m_decoded;
+};
+
+} // namespace Marsyas
+
+#endif // DRUM_DETECTOR_WAV_SOURCE_INCLUDED
@@ -0,0 +1,61 @@
+#include "work_queue.hpp"
+
+#include <cassert>
+
+using namespace std;
+
+work_queue::work_queue(size_t job_count, int worker_count)
+{
+  assert(worker_count > 0);
+
+  for (int w = 0; w < worker_count; ++w)
+    m_workers.push_back(new worker_jobs);
+
+  // Deal jobs round-robin, so that each worker starts near the
+  // beginning of the list and results complete roughly in order.
+  for (size_t j = 0; j < job_count; ++j)
+    m_workers[j % worker_count]->jobs.push_back(j);
+}
+
+work_queue::~work_queue()
+{
+  for (size_t w = 0; w < m_workers.size(); ++w)
+    delete m_workers[w];
+}
+
+bool work_queue::pop(int worker, size_t & job_index)
+{
+  worker_jobs & own = *m_workers[worker];
+
+  {
+    lock_guard<mutex> lock(own.mutex);
+    if (!own.jobs.empty())
+    {
+      job_index = own.jobs.front();
+      own.jobs.pop_front();
+      return true;
+    }
+  }
+
+  return steal(worker, job_index);
+}
+
+bool work_queue::steal(int thief, size_t & job_index)
+{
+  int worker_count = (int) m_workers.size();
+
+  for (int i = 1; i < worker_count; ++i)
+  {
+    worker_jobs & victim = *m_workers[(thief + i) % worker_count];
+
+    lock_guard<mutex> lock(victim.mutex);
+    if (!victim.jobs.empty())
+    {
+      job_index = victim.jobs.back();
+      victim.jobs.pop_back();
+      return true;
+    }
+  }
+
+  return false;
+}
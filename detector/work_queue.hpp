@@ -0,0 +1,34 @@
+#ifndef DRUM_DETECTOR_WORK_QUEUE_INCLUDED
+#define DRUM_DETECTOR_WORK_QUEUE_INCLUDED
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+
+// Distributes job indices among workers. Each worker owns a deque and takes
+// jobs from its front; when it runs dry, it steals from the back of the
+// other workers' deques, so a single long job does not hold back the rest.
+
+class work_queue
+{
+public:
+  work_queue(size_t job_count, int worker_count);
+  ~work_queue();
+
+  // Returns false when no jobs are left anywhere.
+  bool pop(int worker, size_t & job_index);
+
+private:
+  struct worker_jobs
+  {
+    std::mutex mutex;
+    std::deque<size_t> jobs;
+  };
+
+  bool steal(int thief, size_t & job_index);
+
+  std::vector<worker_jobs*> m_workers;
+};
+
+#endif // DRUM_DETECTOR_WORK_QUEUE_INCLUDED
@@ -0,0 +1,136 @@
+#include "decimator.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace Marsyas {
+
+static const int section_count = 4;
+static const double pi = 3.14159265358979323846;
+
+Decimator::Decimator(string name):
+  MarSystem("Decimator", name),
+  m_step(1)
+{
+  addControls();
+}
+
+Decimator::Decimator(const Decimator & other):
+  MarSystem(other),
+  m_step(1)
+{
+  m_factor = getctrl("mrs_natural/factor");
+  m_cutoff = getctrl("mrs_real/cutoff");
+  m_reset = getctrl("mrs_bool/reset");
+}
+
+void Decimator::addControls()
+{
+  addctrl("mrs_natural/factor", (mrs_natural) 8, m_factor);
+  setctrlState("mrs_natural/factor", true);
+  addctrl("mrs_real/cutoff", (mrs_real) 0.8, m_cutoff);
+  setctrlState("mrs_real/cutoff", true);
+  addctrl("mrs_bool/reset", false, m_reset);
+  setctrlState("mrs_bool/reset", true);
+}
+
+void Decimator::myUpdate(MarControlPtr sender)
+{
+  (void) sender;
+
+  mrs_natural factor = std::max((mrs_natural) 1, m_factor->to<mrs_natural>());
+  mrs_natural in_samples = ctrl_inSamples_->to<mrs_natural>();
+
+  if (in_samples % factor)
+  {
+    cerr << "Decimator: inSamples (" << in_samples << ")"
+         << " is not a multiple of factor (" << factor << ")." << endl;
+  }
+
+  ctrl_onObservations_->setValue(ctrl_inObservations_, NOUPDATE);
+  ctrl_onSamples_->setValue(in_samples / factor, NOUPDATE);
+  ctrl_osrate_->setValue(ctrl_israte_->to<mrs_real>() / factor, NOUPDATE);
+  ctrl_onObsNames_->setValue(ctrl_inObsNames_, NOUPDATE);
+
+  m_step = factor;
+
+  // Cutoff as a fraction of the input sample rate.
+  design(m_cutoff->to<mrs_real>() * 0.5 / factor);
+
+  size_t state_size = 2 * section_count * ctrl_inObservations_->to<mrs_natural>();
+  if (state_size != m_state.size())
+    m_state.assign(state_size, 0.0);
+
+  if (m_reset->to<mrs_bool>())
+  {
+    clear();
+    m_reset->setValue(false, NOUPDATE);
+  }
+}
+
+void Decimator::design(mrs_real cutoff)
+{
+  // Butterworth poles split into biquads by bilinear transform
+  // (as in the 'Audio EQ Cookbook' low-pass).
+  const mrs_real w0 = 2.0 * pi * std::min(cutoff, (mrs_real) 0.49);
+  const mrs_real cos_w0 = std::cos(w0);
+  const mrs_real sin_w0 = std::sin(w0);
+  const int order = 2 * section_count;
+
+  m_sections.resize(section_count);
+
+  for (int k = 0; k < section_count; ++k)
+  {
+    mrs_real q = 1.0 / (2.0 * std::cos((2 * k + 1) * pi / (2 * order)));
+    mrs_real alpha = sin_w0 / (2.0 * q);
+    mrs_real a0 = 1.0 + alpha;
+
+    biquad & s = m_sections[k];
+    s.b0 = (1.0 - cos_w0) / 2.0 / a0;
+    s.b1 = (1.0 - cos_w0) / a0;
+    s.b2 = s.b0;
+    s.a1 = -2.0 * cos_w0 / a0;
+    s.a2 = (1.0 - alpha) / a0;
+  }
+}
+
+void Decimator::clear()
+{
+  std::fill(m_state.begin(), m_state.end(), 0.0);
+}
+
+void Decimator::myProcess(realvec & in, realvec & out)
+{
+  for (mrs_natural o = 0; o < inObservations_; ++o)
+  {
+    mrs_real *state = &m_state[2 * section_count * o];
+
+    for (mrs_natural t = 0; t < onSamples_; ++t)
+    {
+      mrs_real y = 0.0;
+
+      for (mrs_natural i = 0; i < m_step; ++i)
+      {
+        y = in(o, t * m_step + i);
+
+        // Transposed direct form II.
+        for (int k = 0; k < section_count; ++k)
+        {
+          const biquad & s = m_sections[k];
+          mrs_real *z = state + 2 * k;
+          mrs_real x = y;
+          y = s.b0 * x + z[0];
+          z[0] = s.b1 * x - s.a1 * y + z[1];
+          z[1] = s.b2 * x - s.a2 * y;
+        }
+      }
+
+      out(o,t) = y;
+    }
+  }
+}
+
+} // namespace Marsyas
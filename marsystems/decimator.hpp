@@ -0,0 +1,50 @@
+#ifndef DRUM_MARSYSTEMS_DECIMATOR_INCLUDED
+#define DRUM_MARSYSTEMS_DECIMATOR_INCLUDED
+
+#include <marsyas/system/MarSystem.h>
+
+#include <vector>
+
+namespace Marsyas {
+
+// Low-pass filters each observation and keeps every 'factor'-th sample.
+// The anti-aliasing filter is an 8th order Butterworth low-pass at
+// 'cutoff' times the output Nyquist frequency.
+// 'inSamples' must be a multiple of 'factor'; the output has
+// inSamples / factor samples at israte / factor.
+// Setting 'reset' clears the filter state.
+
+class Decimator: public MarSystem
+{
+public:
+  Decimator(std::string name);
+  Decimator(const Decimator & other);
+
+  MarSystem *clone() const { return new Decimator(*this); }
+
+private:
+  struct biquad
+  {
+    mrs_real b0, b1, b2, a1, a2;
+  };
+
+  void addControls();
+  void myUpdate(MarControlPtr sender);
+  void myProcess(realvec & in, realvec & out);
+
+  void design(mrs_real cutoff);
+  void clear();
+
+  MarControlPtr m_factor;
+  MarControlPtr m_cutoff;
+  MarControlPtr m_reset;
+
+  mrs_natural m_step;
+  std::vector<biquad> m_sections;
+  // Two state values per section and observation.
+  std::vector<mrs_real> m_state;
+};
+
+} // namespace Marsyas
+
+#endif // DRUM_MARSYSTEMS_DECIMATOR_INCLUDED
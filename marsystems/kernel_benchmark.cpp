@@ -0,0 +1,203 @@
+#include "spectral_kernels.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+//FIXME: Only on POSIX:
+#include <unistd.h>
+
+using namespace std;
+
+// Measures the per-frame cost of each spectral kernel implementation
+// supported by this CPU, for a range of window sizes, and the largest
+// deviation of each result from the scalar implementation.
+
+static void print_usage()
+{
+  cerr << "Usage: kernel_benchmark [-n <frames>]" << endl
+       << "Options:" << endl
+       << "  -n <count>  Number of frames timed per kernel (default: 20000)." << endl;
+}
+
+struct frame_data
+{
+  frame_data(size_t window_size, unsigned seed):
+    n(window_size),
+    bins(window_size / 2 + 1),
+    spectrum(window_size),
+    log_magnitude(bins),
+    previous(bins),
+    out(bins)
+  {
+    mt19937 random(seed);
+    normal_distribution<double> gaussian(0.0, 10.0);
+    for (size_t i = 0; i < n; ++i)
+      spectrum[i] = gaussian(random);
+  }
+
+  size_t n;
+  size_t bins;
+  vector<double> spectrum;
+  vector<double> log_magnitude;
+  vector<double> previous;
+  vector<double> out;
+};
+
+struct kernel_result
+{
+  double log_magnitude;
+  double flux;
+  double moments;
+};
+
+static double relative_error(double value, double reference)
+{
+  double scale = max(fabs(reference), 1e-300);
+  return fabs(value - reference) / scale;
+}
+
+// Returns average nanoseconds per call of 'f'.
+template <typename F>
+static double time_frames(long frames, F f)
+{
+  typedef chrono::steady_clock clock_type;
+  // Warm up caches and branch predictors.
+  for (long i = 0; i < frames / 10 + 1; ++i)
+    f();
+  clock_type::time_point start = clock_type::now();
+  for (long i = 0; i < frames; ++i)
+    f();
+  clock_type::time_point end = clock_type::now();
+  return chrono::duration<double, nano>(end - start).count() / frames;
+}
+
+// Returns the largest relative error of 'kernels' against 'reference'.
+static double compare(const spectral_kernels & kernels,
+                      const spectral_kernels & reference,
+                      size_t window_size)
+{
+  frame_data a(window_size, 1), b(window_size, 1);
+  frame_data next(window_size, 2);
+  double error = 0.0;
+
+  kernels.log_magnitude(&a.spectrum[0], a.n, &a.out[0]);
+  reference.log_magnitude(&b.spectrum[0], b.n, &b.out[0]);
+  for (size_t k = 0; k < a.bins; ++k)
+    error = max(error, relative_error(a.out[k], b.out[k]));
+
+  reference.log_magnitude(&next.spectrum[0], next.n, &next.log_magnitude[0]);
+  a.previous = a.out;
+  b.previous = b.out;
+  double flux_a = kernels.rectified_flux(&next.log_magnitude[0], &a.previous[0], a.bins);
+  double flux_b = reference.rectified_flux(&next.log_magnitude[0], &b.previous[0], b.bins);
+  error = max(error, relative_error(flux_a, flux_b));
+
+  double m0_a, m1_a, m0_b, m1_b;
+  kernels.moments(&a.out[0], a.bins, &m0_a, &m1_a);
+  reference.moments(&b.out[0], b.bins, &m0_b, &m1_b);
+  error = max(error, relative_error(m0_a, m0_b));
+  error = max(error, relative_error(m1_a, m1_b));
+
+  return error;
+}
+
+static kernel_result measure(const spectral_kernels & kernels,
+                             size_t window_size, long frames)
+{
+  frame_data d(window_size, 1);
+  kernel_result result;
+
+  // Keep the results alive, so the calls are not optimized away.
+  volatile double sink = 0.0;
+  double m0, m1;
+
+  result.log_magnitude = time_frames(frames, [&]() {
+    kernels.log_magnitude(&d.spectrum[0], d.n, &d.log_magnitude[0]);
+  });
+
+  result.flux = time_frames(frames, [&]() {
+    sink = kernels.rectified_flux(&d.log_magnitude[0], &d.previous[0], d.bins);
+  });
+
+  result.moments = time_frames(frames, [&]() {
+    kernels.moments(&d.log_magnitude[0], d.bins, &m0, &m1);
+    sink = m1;
+  });
+
+  (void) sink;
+
+  return result;
+}
+
+int main(int argc, char *argv[])
+{
+  long frames = 20000;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'n':
+      frames = atol(optarg);
+      if (frames < 1)
+      {
+        cerr << "Invalid frame count: " << optarg << endl;
+        return 1;
+      }
+      break;
+    default:
+      print_usage();
+      return 1;
+    }
+  }
+
+  const kernel_isa isas[] = { kernel_isa_scalar, kernel_isa_sse2, kernel_isa_avx2 };
+  const size_t window_sizes[] = { 1024, 2048, 4096 };
+
+  const spectral_kernels & reference = *spectral_kernels_for(kernel_isa_scalar);
+
+  cout << "Selected: " << spectral_kernels_best().name << endl;
+  cout << "Nanoseconds per frame:" << endl;
+  cout << setw(8) << "window"
+       << setw(8) << "isa"
+       << setw(12) << "logmag"
+       << setw(12) << "flux"
+       << setw(12) << "moments"
+       << setw(12) << "max error"
+       << endl;
+
+  cout << fixed;
+
+  for (size_t w = 0; w < sizeof(window_sizes) / sizeof(window_sizes[0]); ++w)
+  {
+    for (size_t i = 0; i < sizeof(isas) / sizeof(isas[0]); ++i)
+    {
+      const spectral_kernels *kernels = spectral_kernels_for(isas[i]);
+      if (!kernels)
+        continue;
+
+      kernel_result r = measure(*kernels, window_sizes[w], frames);
+      double error = compare(*kernels, reference, window_sizes[w]);
+
+      cout << setw(8) << window_sizes[w]
+           << setw(8) << kernels->name
+           << setprecision(1)
+           << setw(12) << r.log_magnitude
+           << setw(12) << r.flux
+           << setw(12) << r.moments
+           << scientific << setprecision(1)
+           << setw(12) << error
+           << fixed
+           << endl;
+    }
+  }
+
+  return 0;
+}
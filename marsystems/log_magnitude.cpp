@@ -0,0 +1,47 @@
+#include "log_magnitude.hpp"
+#include "spectral_kernels.hpp"
+
+#include <sstream>
+
+using namespace std;
+
+namespace Marsyas {
+
+LogMagnitude::LogMagnitude(string name):
+  MarSystem("LogMagnitude", name)
+{}
+
+LogMagnitude::LogMagnitude(const LogMagnitude & other):
+  MarSystem(other)
+{}
+
+void LogMagnitude::myUpdate(MarControlPtr sender)
+{
+  (void) sender;
+
+  mrs_natural bin_count = ctrl_inObservations_->to<mrs_natural>() / 2 + 1;
+
+  ctrl_onObservations_->setValue(bin_count, NOUPDATE);
+  ctrl_onSamples_->setValue(ctrl_inSamples_, NOUPDATE);
+  ctrl_osrate_->setValue(ctrl_israte_, NOUPDATE);
+
+  ostringstream names;
+  for (mrs_natural k = 0; k < bin_count; ++k)
+    names << "LogMagnitude_" << k << ",";
+  ctrl_onObsNames_->setValue(names.str(), NOUPDATE);
+}
+
+void LogMagnitude::myProcess(realvec & in, realvec & out)
+{
+  const spectral_kernels & kernels = spectral_kernels_best();
+
+  // realvec stores each column (sample) contiguously.
+  for (mrs_natural t = 0; t < inSamples_; ++t)
+  {
+    kernels.log_magnitude(in.getData() + t * inObservations_,
+                          inObservations_,
+                          out.getData() + t * onObservations_);
+  }
+}
+
+} // namespace Marsyas
@@ -0,0 +1,27 @@
+#ifndef DRUM_MARSYSTEMS_LOG_MAGNITUDE_INCLUDED
+#define DRUM_MARSYSTEMS_LOG_MAGNITUDE_INCLUDED
+
+#include <marsyas/system/MarSystem.h>
+
+namespace Marsyas {
+
+// Equivalent of PowerSpectrum { spectrumType = "logmagnitude" }:
+// turns a packed complex spectrum of N reals (output of Spectrum)
+// into N/2+1 values of log(1 + |X(k)|), using the vectorized kernels.
+
+class LogMagnitude: public MarSystem
+{
+public:
+  LogMagnitude(std::string name);
+  LogMagnitude(const LogMagnitude & other);
+
+  MarSystem *clone() const { return new LogMagnitude(*this); }
+
+private:
+  void myUpdate(MarControlPtr sender);
+  void myProcess(realvec & in, realvec & out);
+};
+
+} // namespace Marsyas
+
+#endif // DRUM_MARSYSTEMS_LOG_MAGNITUDE_INCLUDED
@@ -0,0 +1,34 @@
+#include "marsystems.hpp"
+#include "log_magnitude.hpp"
+#include "rectified_flux.hpp"
+#include "spectral_centroid.hpp"
+#include "decimator.hpp"
+#include "sliding_peaker.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace Marsyas;
+using namespace std;
+
+void register_shared_marsystems(MarSystemManager *manager)
+{
+  manager->registerPrototype("LogMagnitude", new LogMagnitude("logmagnitudepr"));
+  manager->registerPrototype("RectifiedFlux", new RectifiedFlux("rectifiedfluxpr"));
+  manager->registerPrototype("SpectralCentroid", new SpectralCentroid("spectralcentroidpr"));
+  manager->registerPrototype("Decimator", new Decimator("decimatorpr"));
+  manager->registerPrototype("SlidingPeaker", new SlidingPeaker("slidingpeakerpr"));
+}
+
+void reset_state(MarSystem *system)
+{
+  const map<string, MarControlPtr> & controls = system->controls();
+  map<string, MarControlPtr>::const_iterator it = controls.find("mrs_bool/reset");
+  if (it != controls.end())
+    it->second->setValue(true);
+
+  vector<MarSystem*> children = system->getChildren();
+  for (size_t i = 0; i < children.size(); ++i)
+    reset_state(children[i]);
+}
@@ -0,0 +1,15 @@
+#ifndef DRUM_MARSYSTEMS_INCLUDED
+#define DRUM_MARSYSTEMS_INCLUDED
+
+#include <marsyas/system/MarSystemManager.h>
+
+// Registers the MarSystems shared by the detector and the Vamp plugin,
+// so scripts can refer to them by type:
+//   LogMagnitude, RectifiedFlux, SpectralCentroid, Decimator, SlidingPeaker
+void register_shared_marsystems(Marsyas::MarSystemManager *manager);
+
+// Asks every MarSystem in the tree that keeps state across ticks
+// (ShiftInput, Memory, Flux, ...) to clear it before the next tick.
+void reset_state(Marsyas::MarSystem *system);
+
+#endif // DRUM_MARSYSTEMS_INCLUDED
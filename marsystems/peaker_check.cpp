@@ -0,0 +1,261 @@
+#include "sliding_median.hpp"
+#include "sliding_peaker.hpp"
+
+#include <marsyas/realvec.h>
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+//FIXME: Only on POSIX:
+#include <unistd.h>
+
+using namespace std;
+using namespace Marsyas;
+
+// Compares sliding_median and SlidingPeaker, in all threshold modes,
+// with brute-force scans of their windows, on random inputs of small
+// integers, so that there are many ties and all sums are exact.
+// Exits with status 1 on the first mismatch.
+
+static void print_usage()
+{
+  cerr << "Usage: peaker_check [-n <samples>]" << endl
+       << "Options:" << endl
+       << "  -n <count>  Number of input samples per configuration (default: 2000)." << endl;
+}
+
+static double brute_force_median(vector<double> values)
+{
+  sort(values.begin(), values.end());
+  size_t n = values.size();
+  if (n % 2)
+    return values[n / 2];
+  return 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+static bool check_median(long samples, mt19937 & random)
+{
+  uniform_int_distribution<int> small_value(0, 5);
+
+  for (size_t count = 1; count <= 20; ++count)
+  {
+    uniform_int_distribution<size_t> any_index(0, count - 1);
+
+    sliding_median median;
+    median.reset(count);
+    vector<double> values(count, 0.0);
+
+    for (long i = 0; i < samples; ++i)
+    {
+      // Both in ring order, as SlidingPeaker does, and at random.
+      size_t index = i % 2 ? any_index(random) : (size_t) i % count;
+      double value = small_value(random);
+      median.replace(index, value);
+      values[index] = value;
+
+      double expected = brute_force_median(values);
+      if (median.median() != expected)
+      {
+        cerr << "sliding_median: count " << count << ", step " << i
+             << ": " << median.median() << " instead of " << expected << endl;
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+struct peaker_config
+{
+  string mode;
+  long window;
+  long look_ahead;
+  double threshold;
+  double rise_ratio;
+  double floor;
+};
+
+// SlidingPeaker's documented rule, rescanning the whole history for
+// every sample. Samples before the first one are zeros.
+static void brute_force_peaks(const peaker_config & c, const vector<double> & input,
+                              vector<double> & peaks)
+{
+  const long size = max(2 * c.look_ahead + 1, c.window);
+
+  peaks.assign(input.size(), 0.0);
+
+  for (long count = 0; count < (long) input.size(); ++count)
+  {
+    long candidate = count - c.look_ahead;
+    if (candidate < 0)
+      continue;
+
+    double peak = input[candidate];
+
+    bool is_peak = peak > c.floor;
+    for (long k = candidate - c.look_ahead; is_peak && k < candidate; ++k)
+      is_peak = k < 0 || peak > input[k];
+    for (long k = candidate + 1; is_peak && k <= count; ++k)
+      is_peak = !(peak < input[k]);
+    if (!is_peak)
+      continue;
+
+    vector<double> window;
+    for (long k = count - size + 1; k <= count; ++k)
+      window.push_back(k < 0 ? 0.0 : input[k]);
+
+    double sum = 0.0;
+    for (size_t k = 0; k < window.size(); ++k)
+      sum += window[k];
+
+    // The window up to the candidate.
+    double minimum = 0.0;
+    size_t before = window.size() - c.look_ahead - 1;
+    if (before > 0)
+      minimum = *min_element(window.begin(), window.begin() + before);
+
+    bool above_median = peak > c.threshold * brute_force_median(window);
+    bool above_minimum = peak > c.rise_ratio * minimum;
+
+    if (c.mode == "mean")
+      is_peak = peak > c.threshold * sum / size;
+    else if (c.mode == "median")
+      is_peak = above_median;
+    else if (c.mode == "minimum")
+      is_peak = above_minimum;
+    else
+      is_peak = above_median && above_minimum;
+
+    if (is_peak)
+      peaks[count] = 1.0;
+  }
+}
+
+static bool check_peaker(const peaker_config & c, long samples, mt19937 & random)
+{
+  uniform_int_distribution<int> small_value(0, 9);
+  const mrs_natural block_size = 7;
+
+  SlidingPeaker peaker("peaker");
+  peaker.updControl("mrs_natural/inObservations", (mrs_natural) 1);
+  peaker.updControl("mrs_natural/inSamples", block_size);
+  peaker.updControl("mrs_natural/memSize", (mrs_natural) c.window);
+  peaker.updControl("mrs_natural/lookAhead", (mrs_natural) c.look_ahead);
+  peaker.updControl("mrs_string/mode", c.mode);
+  peaker.updControl("mrs_real/threshold", c.threshold);
+  peaker.updControl("mrs_real/riseRatio", c.rise_ratio);
+  peaker.updControl("mrs_real/floor", c.floor);
+
+  realvec in(1, block_size);
+  realvec out(1, block_size);
+
+  // Twice, to check that 'reset' restores the initial state.
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    vector<double> input(samples - samples % block_size);
+    for (size_t i = 0; i < input.size(); ++i)
+      input[i] = small_value(random);
+
+    vector<double> expected;
+    brute_force_peaks(c, input, expected);
+
+    if (pass > 0)
+      peaker.updControl("mrs_bool/reset", true);
+
+    for (size_t start = 0; start < input.size(); start += block_size)
+    {
+      for (mrs_natural t = 0; t < block_size; ++t)
+        in(0, t) = input[start + t];
+
+      peaker.process(in, out);
+
+      for (mrs_natural t = 0; t < block_size; ++t)
+      {
+        if (out(0, t) != expected[start + t])
+        {
+          cerr << "SlidingPeaker: mode " << c.mode
+               << ", window " << c.window
+               << ", look-ahead " << c.look_ahead
+               << ", floor " << c.floor
+               << ", pass " << pass
+               << ", sample " << start + t
+               << ": " << out(0, t) << " instead of " << expected[start + t] << endl;
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  long samples = 2000;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'n':
+      samples = atol(optarg);
+      if (samples < 1)
+      {
+        cerr << "Invalid sample count: " << optarg << endl;
+        return 1;
+      }
+      break;
+    default:
+      print_usage();
+      return 1;
+    }
+  }
+
+  mt19937 random(1);
+
+  if (!check_median(samples, random))
+    return 1;
+  cout << "sliding_median: OK" << endl;
+
+  const char *modes[] = { "mean", "median", "minimum", "hybrid" };
+  const long windows[] = { 1, 2, 5, 18, 33 };
+  const long look_aheads[] = { 0, 1, 4, 9 };
+  const double floors[] = { 0.0, 2.5 };
+
+  int config_count = 0;
+
+  for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m)
+  {
+    for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); ++w)
+    {
+      for (size_t a = 0; a < sizeof(look_aheads) / sizeof(look_aheads[0]); ++a)
+      {
+        for (size_t f = 0; f < sizeof(floors) / sizeof(floors[0]); ++f)
+        {
+          peaker_config c;
+          c.mode = modes[m];
+          c.window = windows[w];
+          c.look_ahead = look_aheads[a];
+          c.threshold = 1.5;
+          c.rise_ratio = 2.0;
+          c.floor = floors[f];
+
+          if (!check_peaker(c, samples, random))
+            return 1;
+
+          ++config_count;
+        }
+      }
+    }
+  }
+
+  cout << "SlidingPeaker: OK (" << config_count << " configurations)" << endl;
+
+  return 0;
+}
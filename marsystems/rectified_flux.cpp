@@ -0,0 +1,67 @@
+#include "rectified_flux.hpp"
+#include "spectral_kernels.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace Marsyas {
+
+RectifiedFlux::RectifiedFlux(string name):
+  MarSystem("RectifiedFlux", name)
+{
+  addControls();
+}
+
+RectifiedFlux::RectifiedFlux(const RectifiedFlux & other):
+  MarSystem(other)
+{
+  m_reset = getctrl("mrs_bool/reset");
+}
+
+void RectifiedFlux::addControls()
+{
+  addctrl("mrs_bool/reset", false, m_reset);
+  setctrlState("mrs_bool/reset", true);
+}
+
+void RectifiedFlux::myUpdate(MarControlPtr sender)
+{
+  (void) sender;
+
+  ctrl_onObservations_->setValue((mrs_natural) 1, NOUPDATE);
+  ctrl_onSamples_->setValue(ctrl_inSamples_, NOUPDATE);
+  ctrl_osrate_->setValue(ctrl_israte_, NOUPDATE);
+  ctrl_onObsNames_->setValue(mrs_string("RectifiedFlux,"), NOUPDATE);
+
+  size_t count = (size_t) ctrl_inObservations_->to<mrs_natural>();
+  if (count != m_previous.size())
+    m_previous.assign(count, 0.0);
+
+  if (m_reset->to<mrs_bool>())
+  {
+    std::fill(m_previous.begin(), m_previous.end(), 0.0);
+    m_reset->setValue(false, NOUPDATE);
+  }
+}
+
+void RectifiedFlux::myProcess(realvec & in, realvec & out)
+{
+  if (m_previous.empty())
+  {
+    out.setval(0.0);
+    return;
+  }
+
+  const spectral_kernels & kernels = spectral_kernels_best();
+
+  // realvec stores each column (sample) contiguously.
+  for (mrs_natural t = 0; t < inSamples_; ++t)
+  {
+    out(0,t) = kernels.rectified_flux(in.getData() + t * inObservations_,
+                                      &m_previous[0],
+                                      m_previous.size());
+  }
+}
+
+} // namespace Marsyas
@@ -0,0 +1,35 @@
+#ifndef DRUM_MARSYSTEMS_RECTIFIED_FLUX_INCLUDED
+#define DRUM_MARSYSTEMS_RECTIFIED_FLUX_INCLUDED
+
+#include <marsyas/system/MarSystem.h>
+
+#include <vector>
+
+namespace Marsyas {
+
+// Equivalent of Flux { mode = "Laroche2003" }:
+// sum over all observations of the positive increase since the previous
+// sample (half-wave rectified flux), using the vectorized kernels.
+// Setting 'reset' forgets the previous sample.
+
+class RectifiedFlux: public MarSystem
+{
+public:
+  RectifiedFlux(std::string name);
+  RectifiedFlux(const RectifiedFlux & other);
+
+  MarSystem *clone() const { return new RectifiedFlux(*this); }
+
+private:
+  void addControls();
+  void myUpdate(MarControlPtr sender);
+  void myProcess(realvec & in, realvec & out);
+
+  MarControlPtr m_reset;
+
+  std::vector<mrs_real> m_previous;
+};
+
+} // namespace Marsyas
+
+#endif // DRUM_MARSYSTEMS_RECTIFIED_FLUX_INCLUDED
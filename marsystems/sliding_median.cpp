@@ -0,0 +1,112 @@
+#include "sliding_median.hpp"
+
+#include <cassert>
+
+sliding_median::sliding_median()
+{}
+
+void sliding_median::reset(size_t count, double value)
+{
+  m_values.assign(count, value);
+  m_heap_of.resize(count);
+  m_position.resize(count);
+  m_heaps[lower_heap].clear();
+  m_heaps[upper_heap].clear();
+
+  // Equal values are in heap order anyway.
+  for (size_t i = 0; i < count; ++i)
+  {
+    int heap = i < (count + 1) / 2 ? lower_heap : upper_heap;
+    m_heap_of[i] = heap;
+    m_position[i] = m_heaps[heap].size();
+    m_heaps[heap].push_back(i);
+  }
+}
+
+// Whether heap entry 'a' belongs above 'b'.
+bool sliding_median::before(int heap, size_t a, size_t b) const
+{
+  double value_a = m_values[m_heaps[heap][a]];
+  double value_b = m_values[m_heaps[heap][b]];
+  return heap == lower_heap ? value_a > value_b : value_a < value_b;
+}
+
+void sliding_median::swap_entries(int heap, size_t a, size_t b)
+{
+  std::vector<size_t> & entries = m_heaps[heap];
+  size_t index_a = entries[a];
+  size_t index_b = entries[b];
+  entries[a] = index_b;
+  entries[b] = index_a;
+  m_position[index_b] = a;
+  m_position[index_a] = b;
+}
+
+void sliding_median::sift_up(int heap, size_t position)
+{
+  while (position > 0)
+  {
+    size_t parent = (position - 1) / 2;
+    if (!before(heap, position, parent))
+      break;
+    swap_entries(heap, position, parent);
+    position = parent;
+  }
+}
+
+void sliding_median::sift_down(int heap, size_t position)
+{
+  size_t size = m_heaps[heap].size();
+  for (;;)
+  {
+    size_t first = position;
+    size_t left = 2 * position + 1;
+    size_t right = left + 1;
+    if (left < size && before(heap, left, first))
+      first = left;
+    if (right < size && before(heap, right, first))
+      first = right;
+    if (first == position)
+      break;
+    swap_entries(heap, position, first);
+    position = first;
+  }
+}
+
+void sliding_median::replace(size_t index, double value)
+{
+  assert(index < m_values.size());
+
+  int heap = m_heap_of[index];
+  m_values[index] = value;
+  sift_up(heap, m_position[index]);
+  sift_down(heap, m_position[index]);
+
+  if (m_heaps[upper_heap].empty())
+    return;
+
+  // Only the replaced value can be on the wrong side: exchanging the tops
+  // restores the order between the heaps.
+  size_t lower_top = m_heaps[lower_heap][0];
+  size_t upper_top = m_heaps[upper_heap][0];
+  if (!(m_values[lower_top] > m_values[upper_top]))
+    return;
+
+  m_heaps[lower_heap][0] = upper_top;
+  m_heaps[upper_heap][0] = lower_top;
+  m_heap_of[upper_top] = lower_heap;
+  m_heap_of[lower_top] = upper_heap;
+  sift_down(lower_heap, 0);
+  sift_down(upper_heap, 0);
+}
+
+double sliding_median::median() const
+{
+  if (m_values.empty())
+    return 0.0;
+
+  double lower = m_values[m_heaps[lower_heap][0]];
+  if (m_values.size() % 2)
+    return lower;
+  return 0.5 * (lower + m_values[m_heaps[upper_heap][0]]);
+}
@@ -0,0 +1,42 @@
+#ifndef DRUM_MARSYSTEMS_SLIDING_MEDIAN_INCLUDED
+#define DRUM_MARSYSTEMS_SLIDING_MEDIAN_INCLUDED
+
+#include <cstddef>
+#include <vector>
+
+// Median of a fixed number of values, one of which is replaced at a time,
+// in O(log n) per replacement: the lower half of the values is kept in
+// a max-heap and the upper half in a min-heap, each heap entry being the
+// index of a value, so that any value can be found and replaced.
+
+class sliding_median
+{
+public:
+  sliding_median();
+
+  // 'count' values, all 'value'.
+  void reset(size_t count, double value = 0.0);
+
+  // Replaces value 'index' (below the count).
+  void replace(size_t index, double value);
+
+  double median() const;
+
+private:
+  enum { lower_heap = 0, upper_heap = 1 };
+
+  bool before(int heap, size_t a, size_t b) const;
+  void swap_entries(int heap, size_t a, size_t b);
+  void sift_up(int heap, size_t position);
+  void sift_down(int heap, size_t position);
+
+  std::vector<double> m_values;
+  // Value indices in heap order; lower_heap holds the extra value
+  // for an odd count.
+  std::vector<size_t> m_heaps[2];
+  // Heap and position of each value.
+  std::vector<int> m_heap_of;
+  std::vector<size_t> m_position;
+};
+
+#endif // DRUM_MARSYSTEMS_SLIDING_MEDIAN_INCLUDED
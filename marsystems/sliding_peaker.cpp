@@ -0,0 +1,235 @@
+#include "sliding_peaker.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+namespace Marsyas {
+
+void SlidingPeaker::count_queue::clear(size_t capacity)
+{
+  counts.resize(capacity);
+  front = 0;
+  size = 0;
+}
+
+void SlidingPeaker::count_queue::pop_first()
+{
+  front = (front + 1) % counts.size();
+  --size;
+}
+
+void SlidingPeaker::count_queue::pop_last()
+{
+  --size;
+}
+
+void SlidingPeaker::count_queue::push(long count)
+{
+  counts[(front + size) % counts.size()] = count;
+  ++size;
+}
+
+SlidingPeaker::SlidingPeaker(string name):
+  MarSystem("SlidingPeaker", name),
+  m_threshold_mode(mean_threshold),
+  m_sum(0.0),
+  m_count(0),
+  m_look_ahead_count(0)
+{
+  addControls();
+}
+
+SlidingPeaker::SlidingPeaker(const SlidingPeaker & other):
+  MarSystem(other),
+  m_threshold_mode(mean_threshold),
+  m_sum(0.0),
+  m_count(0),
+  m_look_ahead_count(0)
+{
+  m_mem_size = getctrl("mrs_natural/memSize");
+  m_look_ahead = getctrl("mrs_natural/lookAhead");
+  m_mode = getctrl("mrs_string/mode");
+  m_threshold = getctrl("mrs_real/threshold");
+  m_rise_ratio = getctrl("mrs_real/riseRatio");
+  m_floor = getctrl("mrs_real/floor");
+  m_confidence = getctrl("mrs_real/confidence");
+  m_reset = getctrl("mrs_bool/reset");
+}
+
+void SlidingPeaker::addControls()
+{
+  addctrl("mrs_natural/memSize", (mrs_natural) 18, m_mem_size);
+  setctrlState("mrs_natural/memSize", true);
+  addctrl("mrs_natural/lookAhead", (mrs_natural) 4, m_look_ahead);
+  setctrlState("mrs_natural/lookAhead", true);
+  addctrl("mrs_string/mode", mrs_string("mean"), m_mode);
+  setctrlState("mrs_string/mode", true);
+  addctrl("mrs_real/threshold", 1.0, m_threshold);
+  addctrl("mrs_real/riseRatio", 2.0, m_rise_ratio);
+  addctrl("mrs_real/floor", 0.0, m_floor);
+  addctrl("mrs_real/confidence", 0.0, m_confidence);
+  addctrl("mrs_bool/reset", false, m_reset);
+  setctrlState("mrs_bool/reset", true);
+}
+
+void SlidingPeaker::myUpdate(MarControlPtr sender)
+{
+  (void) sender;
+
+  ctrl_onObservations_->setValue((mrs_natural) 1, NOUPDATE);
+  ctrl_onSamples_->setValue(ctrl_inSamples_, NOUPDATE);
+  ctrl_osrate_->setValue(ctrl_israte_, NOUPDATE);
+  ctrl_onObsNames_->setValue(mrs_string("Peak,"), NOUPDATE);
+
+  const mrs_string & mode_name = m_mode->to<mrs_string>();
+  threshold_mode mode = mean_threshold;
+  if (mode_name == "median")
+    mode = median_threshold;
+  else if (mode_name == "minimum")
+    mode = minimum_threshold;
+  else if (mode_name == "hybrid")
+    mode = hybrid_threshold;
+  else if (mode_name != "mean")
+    cerr << "SlidingPeaker: Unknown mode: " << mode_name << endl;
+
+  // The neighbourhood of the peak candidate must lie within the window.
+  m_look_ahead_count = std::max((mrs_natural) 0, m_look_ahead->to<mrs_natural>());
+  size_t size = (size_t) std::max(2 * m_look_ahead_count + 1, (long) m_mem_size->to<mrs_natural>());
+
+  if (size != m_values.size() || mode != m_threshold_mode)
+  {
+    m_threshold_mode = mode;
+    m_values.resize(size);
+    clear();
+  }
+
+  if (m_reset->to<mrs_bool>())
+  {
+    clear();
+    m_reset->setValue(false, NOUPDATE);
+  }
+}
+
+void SlidingPeaker::clear()
+{
+  // A window of zeros. As the onset function is not negative, they are
+  // left out of the maximum queue.
+  std::fill(m_values.begin(), m_values.end(), 0.0);
+  m_sum = 0.0;
+  m_max_queue.clear(m_values.size());
+  m_min_queue.clear(m_values.size());
+  if (m_threshold_mode == median_threshold || m_threshold_mode == hybrid_threshold)
+    m_median.reset(m_values.size());
+  m_count = 0;
+}
+
+mrs_real SlidingPeaker::value(long count) const
+{
+  return count < 0 ? 0.0 : m_values[count % m_values.size()];
+}
+
+bool SlidingPeaker::push(mrs_real value, mrs_real & peak)
+{
+  const long size = (long) m_values.size();
+  const long index = m_count % size;
+
+  // Recompute the sum once per window, so rounding errors do not accumulate.
+  if (index == 0)
+  {
+    m_sum = value;
+    for (long i = 1; i < size; ++i)
+      m_sum += m_values[i];
+  }
+  else
+  {
+    m_sum += value - m_values[index];
+  }
+  m_values[index] = value;
+
+  bool use_median =
+      m_threshold_mode == median_threshold || m_threshold_mode == hybrid_threshold;
+  bool use_minimum =
+      m_threshold_mode == minimum_threshold || m_threshold_mode == hybrid_threshold;
+
+  if (use_median)
+    m_median.replace(index, value);
+
+  // Drop the sample leaving the neighbourhood of the candidate,
+  // i.e. the last 2 * lookAhead + 1 samples, then all lower values.
+  if (m_max_queue.size && m_max_queue.first() <= m_count - (2 * m_look_ahead_count + 1))
+    m_max_queue.pop_first();
+  while (m_max_queue.size && this->value(m_max_queue.last()) < value)
+    m_max_queue.pop_last();
+  m_max_queue.push(m_count);
+
+  long candidate = m_count - m_look_ahead_count;
+
+  // The samples before the candidate enter the minimum queue one by one,
+  // starting with the zeros before the first sample.
+  if (use_minimum)
+  {
+    long first_before = m_count - size + 1;
+    long newest_before = candidate - 1;
+    if (m_min_queue.size && m_min_queue.first() < first_before)
+      m_min_queue.pop_first();
+    if (newest_before >= first_before)
+    {
+      mrs_real newest = this->value(newest_before);
+      while (m_min_queue.size && !(this->value(m_min_queue.last()) < newest))
+        m_min_queue.pop_last();
+      m_min_queue.push(newest_before);
+    }
+  }
+
+  ++m_count;
+
+  // The first of equal maxima is at the front.
+  if (candidate < 0 || m_max_queue.first() != candidate)
+    return false;
+
+  peak = m_values[candidate % size];
+  if (!(peak > m_floor->to<mrs_real>()))
+    return false;
+
+  mrs_real threshold = m_threshold->to<mrs_real>();
+
+  switch (m_threshold_mode)
+  {
+  case mean_threshold:
+    return peak > threshold * m_sum / size;
+  case median_threshold:
+    return peak > threshold * m_median.median();
+  case minimum_threshold:
+  case hybrid_threshold:
+    {
+      // Without samples before the candidate, the minimum is 0.
+      mrs_real minimum = m_min_queue.size ? this->value(m_min_queue.first()) : 0.0;
+      if (!(peak > m_rise_ratio->to<mrs_real>() * minimum))
+        return false;
+      return m_threshold_mode == minimum_threshold ||
+          peak > threshold * m_median.median();
+    }
+  }
+
+  return false;
+}
+
+void SlidingPeaker::myProcess(realvec & in, realvec & out)
+{
+  mrs_real confidence = 0.0;
+
+  for (mrs_natural t = 0; t < inSamples_; ++t)
+  {
+    mrs_real peak;
+    bool found = push(in(0,t), peak);
+    out(0,t) = found ? 1.0 : 0.0;
+    if (found)
+      confidence = peak / 100.0;
+  }
+
+  m_confidence->setValue(confidence, NOUPDATE);
+}
+
+} // namespace Marsyas
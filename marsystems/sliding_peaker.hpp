@@ -0,0 +1,102 @@
+#ifndef DRUM_MARSYSTEMS_SLIDING_PEAKER_INCLUDED
+#define DRUM_MARSYSTEMS_SLIDING_PEAKER_INCLUDED
+
+#include "sliding_median.hpp"
+
+#include <marsyas/system/MarSystem.h>
+
+#include <vector>
+
+namespace Marsyas {
+
+// Peak picking on an onset function with one value per sample,
+// replacing Memory { memSize = N } -> PeakerOnset.
+// Keeps the last 'memSize' values, and reports the value 'lookAhead'
+// samples before the newest as a peak when, as with PeakerOnset, it is
+// the maximum of its neighbourhood of 'lookAhead' samples on each side -
+// higher than those before it, and not lower than those after it -
+// exceeds 'floor', and passes the threshold of 'mode' over the window:
+// - "mean" (default): above 'threshold' times the window mean,
+// - "median": above 'threshold' times the window median,
+// - "minimum": above 'riseRatio' times the trailing minimum, i.e. the
+//   lowest value in the window before the peak,
+// - "hybrid": both the "median" and the "minimum" condition.
+// With 'lookAhead' = 0, every sample passing the threshold is a peak.
+// The window is at least 2 * 'lookAhead' + 1 samples long.
+// Output is 1 for a peak, else 0. 'confidence' is the peak value / 100,
+// as with PeakerOnset, or 0 without a peak.
+// The mean is a running sum, the median is kept in two heaps, and the
+// maximum and minimum in monotonic queues, so the cost per sample is
+// constant (O(log memSize) for the median) and no window is rescanned.
+// Setting 'reset' clears the window to zeros.
+
+class SlidingPeaker: public MarSystem
+{
+public:
+  SlidingPeaker(std::string name);
+  SlidingPeaker(const SlidingPeaker & other);
+
+  MarSystem *clone() const { return new SlidingPeaker(*this); }
+
+private:
+  enum threshold_mode
+  {
+    mean_threshold,
+    median_threshold,
+    minimum_threshold,
+    hybrid_threshold
+  };
+
+  // Ring of sample counts of a monotonic queue.
+  struct count_queue
+  {
+    std::vector<long> counts;
+    size_t front;
+    size_t size;
+
+    void clear(size_t capacity);
+    long first() const { return counts[front]; }
+    long last() const { return counts[(front + size - 1) % counts.size()]; }
+    void pop_first();
+    void pop_last();
+    void push(long count);
+  };
+
+  void addControls();
+  void myUpdate(MarControlPtr sender);
+  void myProcess(realvec & in, realvec & out);
+
+  void clear();
+  // Value at a sample count within the window; zero before the first one.
+  mrs_real value(long count) const;
+  // Adds a value; returns true if it completes the window of a peak.
+  bool push(mrs_real value, mrs_real & peak);
+
+  MarControlPtr m_mem_size;
+  MarControlPtr m_look_ahead;
+  MarControlPtr m_mode;
+  MarControlPtr m_threshold;
+  MarControlPtr m_rise_ratio;
+  MarControlPtr m_floor;
+  MarControlPtr m_confidence;
+  MarControlPtr m_reset;
+
+  threshold_mode m_threshold_mode;
+
+  // Last 'memSize' values, indexed by sample count modulo 'memSize'.
+  std::vector<mrs_real> m_values;
+  mrs_real m_sum;
+  sliding_median m_median;
+  // Sample counts of decreasing values in the candidate's neighbourhood,
+  // its maximum first.
+  count_queue m_max_queue;
+  // Sample counts of increasing values before the peak candidate,
+  // their minimum first.
+  count_queue m_min_queue;
+  long m_count;
+  long m_look_ahead_count;
+};
+
+} // namespace Marsyas
+
+#endif // DRUM_MARSYSTEMS_SLIDING_PEAKER_INCLUDED
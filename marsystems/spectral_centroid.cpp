@@ -0,0 +1,39 @@
+#include "spectral_centroid.hpp"
+#include "spectral_kernels.hpp"
+
+using namespace std;
+
+namespace Marsyas {
+
+SpectralCentroid::SpectralCentroid(string name):
+  MarSystem("SpectralCentroid", name)
+{}
+
+SpectralCentroid::SpectralCentroid(const SpectralCentroid & other):
+  MarSystem(other)
+{}
+
+void SpectralCentroid::myUpdate(MarControlPtr sender)
+{
+  (void) sender;
+
+  ctrl_onObservations_->setValue((mrs_natural) 1, NOUPDATE);
+  ctrl_onSamples_->setValue(ctrl_inSamples_, NOUPDATE);
+  ctrl_osrate_->setValue(ctrl_israte_, NOUPDATE);
+  ctrl_onObsNames_->setValue(mrs_string("SpectralCentroid,"), NOUPDATE);
+}
+
+void SpectralCentroid::myProcess(realvec & in, realvec & out)
+{
+  const spectral_kernels & kernels = spectral_kernels_best();
+
+  // realvec stores each column (sample) contiguously.
+  for (mrs_natural t = 0; t < inSamples_; ++t)
+  {
+    mrs_real m0, m1;
+    kernels.moments(in.getData() + t * inObservations_, inObservations_, &m0, &m1);
+    out(0,t) = m0 > 0.0 ? m1 / m0 / inObservations_ : 0.0;
+  }
+}
+
+} // namespace Marsyas
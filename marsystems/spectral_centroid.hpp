@@ -0,0 +1,27 @@
+#ifndef DRUM_MARSYSTEMS_SPECTRAL_CENTROID_INCLUDED
+#define DRUM_MARSYSTEMS_SPECTRAL_CENTROID_INCLUDED
+
+#include <marsyas/system/MarSystem.h>
+
+namespace Marsyas {
+
+// Equivalent of Centroid: centroid of a magnitude or power spectrum,
+// as a fraction of the number of bins, using the vectorized kernels.
+// Outputs 0 for a silent spectrum.
+
+class SpectralCentroid: public MarSystem
+{
+public:
+  SpectralCentroid(std::string name);
+  SpectralCentroid(const SpectralCentroid & other);
+
+  MarSystem *clone() const { return new SpectralCentroid(*this); }
+
+private:
+  void myUpdate(MarControlPtr sender);
+  void myProcess(realvec & in, realvec & out);
+};
+
+} // namespace Marsyas
+
+#endif // DRUM_MARSYSTEMS_SPECTRAL_CENTROID_INCLUDED
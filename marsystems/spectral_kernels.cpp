@@ -0,0 +1,100 @@
+#include "spectral_kernels_impl.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+struct scalar
+{
+  typedef double reg;
+  static const size_t width = 1;
+
+  static reg load(const double *p) { return *p; }
+  static void store(double *p, reg a) { *p = a; }
+  static reg set1(double v) { return v; }
+  static reg iota() { return 0.0; }
+
+  static reg add(reg a, reg b) { return a + b; }
+  static reg sub(reg a, reg b) { return a - b; }
+  static reg mul(reg a, reg b) { return a * b; }
+  static reg div(reg a, reg b) { return a / b; }
+  static reg max(reg a, reg b) { return std::max(a, b); }
+  static reg sqrt(reg a) { return std::sqrt(a); }
+  static reg log(reg a) { return std::log(a); }
+  static double sum(reg a) { return a; }
+
+  static reg power_pairs(const double *p) { return p[0] * p[0] + p[1] * p[1]; }
+};
+
+}
+
+#ifdef DRUM_X86_KERNELS
+const spectral_kernels & spectral_kernels_sse2();
+const spectral_kernels & spectral_kernels_avx2();
+#endif
+
+static const spectral_kernels & spectral_kernels_scalar()
+{
+  static const spectral_kernels kernels =
+      spectral_kernels_impl::make_kernels<scalar>("scalar");
+  return kernels;
+}
+
+const spectral_kernels * spectral_kernels_for(kernel_isa isa)
+{
+  switch (isa)
+  {
+  case kernel_isa_scalar:
+    return &spectral_kernels_scalar();
+#ifdef DRUM_X86_KERNELS
+  case kernel_isa_sse2:
+    if (__builtin_cpu_supports("sse2"))
+      return &spectral_kernels_sse2();
+    break;
+  case kernel_isa_avx2:
+    if (__builtin_cpu_supports("avx2"))
+      return &spectral_kernels_avx2();
+    break;
+#endif
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+static const spectral_kernels & select_kernels()
+{
+  const char *forced = std::getenv("DRUM_KERNELS");
+  if (forced)
+  {
+    const spectral_kernels *kernels = 0;
+    if (!std::strcmp(forced, "scalar"))
+      kernels = spectral_kernels_for(kernel_isa_scalar);
+    else if (!std::strcmp(forced, "sse2"))
+      kernels = spectral_kernels_for(kernel_isa_sse2);
+    else if (!std::strcmp(forced, "avx2"))
+      kernels = spectral_kernels_for(kernel_isa_avx2);
+    if (kernels)
+      return *kernels;
+  }
+
+  const kernel_isa preference[] = { kernel_isa_avx2, kernel_isa_sse2 };
+  for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); ++i)
+  {
+    const spectral_kernels *kernels = spectral_kernels_for(preference[i]);
+    if (kernels)
+      return *kernels;
+  }
+
+  return spectral_kernels_scalar();
+}
+
+const spectral_kernels & spectral_kernels_best()
+{
+  static const spectral_kernels & kernels = select_kernels();
+  return kernels;
+}
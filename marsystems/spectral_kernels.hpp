@@ -0,0 +1,43 @@
+#ifndef DRUM_SPECTRAL_KERNELS_INCLUDED
+#define DRUM_SPECTRAL_KERNELS_INCLUDED
+
+#include <cstddef>
+
+// Per-frame spectral kernels on double precision data, with SSE2 and AVX2
+// implementations selected at runtime, and a portable scalar fallback.
+//
+// A packed spectrum is the output of Marsyas' Spectrum for a window of
+// n samples: Re(0), Re(n/2), Re(1), Im(1), ..., Re(n/2-1), Im(n/2-1),
+// holding n/2+1 bins.
+
+struct spectral_kernels
+{
+  const char *name;
+
+  // out[k] = log(1 + |X(k)|) for all n/2+1 bins.
+  void (*log_magnitude)(const double *spectrum, size_t n, double *out);
+
+  // Sum of positive differences 'current' - 'previous' (half-wave rectified
+  // flux); then 'previous' is overwritten with 'current'.
+  double (*rectified_flux)(const double *current, double *previous, size_t count);
+
+  // m0 = sum of values[k], m1 = sum of k * values[k].
+  void (*moments)(const double *values, size_t count, double *m0, double *m1);
+};
+
+enum kernel_isa
+{
+  kernel_isa_scalar,
+  kernel_isa_sse2,
+  kernel_isa_avx2
+};
+
+// Best implementation supported by this CPU.
+// Setting the environment variable DRUM_KERNELS to "scalar", "sse2" or "avx2"
+// forces a (supported) implementation.
+const spectral_kernels & spectral_kernels_best();
+
+// Null if not supported by this build or CPU.
+const spectral_kernels * spectral_kernels_for(kernel_isa isa);
+
+#endif // DRUM_SPECTRAL_KERNELS_INCLUDED
@@ -0,0 +1,68 @@
+#include "spectral_kernels_impl.hpp"
+
+#include <immintrin.h>
+
+namespace {
+
+struct avx2
+{
+  typedef __m256d reg;
+  static const size_t width = 4;
+
+  static reg load(const double *p) { return _mm256_loadu_pd(p); }
+  static void store(double *p, reg a) { _mm256_storeu_pd(p, a); }
+  static reg set1(double v) { return _mm256_set1_pd(v); }
+  static reg iota() { return _mm256_set_pd(3.0, 2.0, 1.0, 0.0); }
+
+  static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+  static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+  static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+  static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+  static reg sqrt(reg a) { return _mm256_sqrt_pd(a); }
+  static reg lt(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static reg select(reg mask, reg a, reg b) { return _mm256_blendv_pd(b, a, mask); }
+
+  static double sum(reg a)
+  {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+    return _mm_cvtsd_f64(_mm_add_pd(s, _mm_unpackhi_pd(s, s)));
+  }
+
+  static reg power_pairs(const double *p)
+  {
+    reg a = _mm256_loadu_pd(p);     // re0 im0 re1 im1
+    reg b = _mm256_loadu_pd(p + 4); // re2 im2 re3 im3
+    a = _mm256_mul_pd(a, a);
+    b = _mm256_mul_pd(b, b);
+    reg h = _mm256_hadd_pd(a, b);   // p0 p2 p1 p3
+    return _mm256_permute4x64_pd(h, _MM_SHUFFLE(3, 1, 2, 0));
+  }
+
+  // x = mantissa * 2^exponent, mantissa in [0.5, 1), for positive normal x.
+  static void split_exponent(reg x, reg & mantissa, reg & exponent)
+  {
+    const __m256i mantissa_bits = _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL);
+    const __m256i half_bits = _mm256_set1_epi64x(0x3FE0000000000000LL);
+    const reg two52 = _mm256_set1_pd(4503599627370496.0);
+
+    __m256i bits = _mm256_castpd_si256(x);
+    mantissa = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, mantissa_bits), half_bits));
+
+    // Biased exponent placed into the mantissa of 2^52 converts exactly.
+    __m256i biased = _mm256_srli_epi64(bits, 52);
+    reg e = _mm256_castsi256_pd(_mm256_or_si256(biased, _mm256_castpd_si256(two52)));
+    exponent = _mm256_sub_pd(e, _mm256_set1_pd(4503599627370496.0 + 1022.0));
+  }
+
+  static reg log(reg x) { return spectral_kernels_impl::cephes_log<avx2>(x); }
+};
+
+}
+
+const spectral_kernels & spectral_kernels_avx2()
+{
+  static const spectral_kernels kernels =
+      spectral_kernels_impl::make_kernels<avx2>("avx2");
+  return kernels;
+}
@@ -0,0 +1,163 @@
+#ifndef DRUM_SPECTRAL_KERNELS_IMPL_INCLUDED
+#define DRUM_SPECTRAL_KERNELS_IMPL_INCLUDED
+
+// Kernel algorithms, generic over a vector type V providing:
+//   typedef ... reg;  static const size_t width;
+//   load, store, set1, add, sub, mul, div, max, sqrt, log, sum,
+//   iota (0, 1, ... width-1),
+//   power_pairs (width powers from 2 * width interleaved re/im values).
+// Each implementation file instantiates them with its own V.
+// Non-template helpers must have internal linkage: each implementation file
+// is compiled for a different instruction set, and the linker must not
+// substitute one file's copy for another's.
+
+#include "spectral_kernels.hpp"
+
+#include <cmath>
+
+namespace spectral_kernels_impl {
+
+// Natural logarithm of positive, normal numbers, after Cephes' log():
+// x = m * 2^e with m in [sqrt(1/2), sqrt(2)), log(m) by rational approximation.
+// V additionally provides lt, select and split_exponent.
+template <typename V>
+inline typename V::reg cephes_log(typename V::reg x)
+{
+  typedef typename V::reg reg;
+
+  const reg one = V::set1(1.0);
+  const reg zero = V::set1(0.0);
+
+  reg m, e;
+  V::split_exponent(x, m, e); // m in [0.5, 1)
+
+  reg small = V::lt(m, V::set1(0.70710678118654752440));
+  e = V::sub(e, V::select(small, one, zero));
+  x = V::sub(V::add(m, V::select(small, m, zero)), one);
+
+  reg z = V::mul(x, x);
+
+  reg p = V::set1(1.01875663804580931796E-4);
+  p = V::add(V::mul(p, x), V::set1(4.97494994976747001425E-1));
+  p = V::add(V::mul(p, x), V::set1(4.70579119878881725854E0));
+  p = V::add(V::mul(p, x), V::set1(1.44989225341610930846E1));
+  p = V::add(V::mul(p, x), V::set1(1.79368678507819816313E1));
+  p = V::add(V::mul(p, x), V::set1(7.70838733755885391666E0));
+
+  reg q = V::add(x, V::set1(1.12873587189167450590E1));
+  q = V::add(V::mul(q, x), V::set1(4.52279145837532221105E1));
+  q = V::add(V::mul(q, x), V::set1(8.29875266912776603211E1));
+  q = V::add(V::mul(q, x), V::set1(7.11544750618563894466E1));
+  q = V::add(V::mul(q, x), V::set1(2.31251620126765340583E1));
+
+  reg y = V::mul(x, V::div(V::mul(z, p), q));
+  y = V::sub(y, V::mul(e, V::set1(2.121944400546905827679e-4)));
+  y = V::sub(y, V::mul(V::set1(0.5), z));
+
+  reg r = V::add(x, y);
+  return V::add(r, V::mul(e, V::set1(0.693359375)));
+}
+
+static inline double log_magnitude_of(double re, double im)
+{
+  return std::log(1.0 + std::sqrt(re * re + im * im));
+}
+
+template <typename V>
+void log_magnitude(const double *spectrum, size_t n, double *out)
+{
+  typedef typename V::reg reg;
+
+  const size_t half = n / 2;
+  const reg one = V::set1(1.0);
+
+  out[0] = log_magnitude_of(spectrum[0], 0.0);
+  if (half > 0)
+    out[half] = log_magnitude_of(spectrum[1], 0.0);
+
+  size_t k = 1;
+  for (; k + V::width <= half; k += V::width)
+  {
+    reg power = V::power_pairs(spectrum + 2 * k);
+    V::store(out + k, V::log(V::add(one, V::sqrt(power))));
+  }
+  for (; k < half; ++k)
+    out[k] = log_magnitude_of(spectrum[2 * k], spectrum[2 * k + 1]);
+}
+
+template <typename V>
+double rectified_flux(const double *current, double *previous, size_t count)
+{
+  typedef typename V::reg reg;
+
+  const reg zero = V::set1(0.0);
+  reg sum = zero;
+
+  size_t k = 0;
+  for (; k + V::width <= count; k += V::width)
+  {
+    reg c = V::load(current + k);
+    reg difference = V::sub(c, V::load(previous + k));
+    sum = V::add(sum, V::max(difference, zero));
+    V::store(previous + k, c);
+  }
+
+  double flux = V::sum(sum);
+
+  for (; k < count; ++k)
+  {
+    double difference = current[k] - previous[k];
+    if (difference > 0.0)
+      flux += difference;
+    previous[k] = current[k];
+  }
+
+  return flux;
+}
+
+template <typename V>
+void moments(const double *values, size_t count, double *m0, double *m1)
+{
+  typedef typename V::reg reg;
+
+  reg sum0 = V::set1(0.0);
+  reg sum1 = V::set1(0.0);
+  reg index = V::iota();
+  const reg step = V::set1((double) V::width);
+
+  size_t k = 0;
+  for (; k + V::width <= count; k += V::width)
+  {
+    reg v = V::load(values + k);
+    sum0 = V::add(sum0, v);
+    sum1 = V::add(sum1, V::mul(index, v));
+    index = V::add(index, step);
+  }
+
+  double s0 = V::sum(sum0);
+  double s1 = V::sum(sum1);
+
+  for (; k < count; ++k)
+  {
+    s0 += values[k];
+    s1 += k * values[k];
+  }
+
+  *m0 = s0;
+  *m1 = s1;
+}
+
+template <typename V>
+spectral_kernels make_kernels(const char *name)
+{
+  spectral_kernels kernels;
+  kernels.name = name;
+  kernels.log_magnitude = &log_magnitude<V>;
+  kernels.rectified_flux = &rectified_flux<V>;
+  kernels.moments = &moments<V>;
+  return kernels;
+}
+
+} // namespace spectral_kernels_impl
+
+#endif // DRUM_SPECTRAL_KERNELS_IMPL_INCLUDED
@@ -0,0 +1,70 @@
+#include "spectral_kernels_impl.hpp"
+
+#include <emmintrin.h>
+
+namespace {
+
+struct sse2
+{
+  typedef __m128d reg;
+  static const size_t width = 2;
+
+  static reg load(const double *p) { return _mm_loadu_pd(p); }
+  static void store(double *p, reg a) { _mm_storeu_pd(p, a); }
+  static reg set1(double v) { return _mm_set1_pd(v); }
+  static reg iota() { return _mm_set_pd(1.0, 0.0); }
+
+  static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+  static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+  static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+  static reg div(reg a, reg b) { return _mm_div_pd(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+  static reg sqrt(reg a) { return _mm_sqrt_pd(a); }
+  static reg lt(reg a, reg b) { return _mm_cmplt_pd(a, b); }
+
+  static reg select(reg mask, reg a, reg b)
+  {
+    return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+  }
+
+  static double sum(reg a)
+  {
+    return _mm_cvtsd_f64(_mm_add_pd(a, _mm_unpackhi_pd(a, a)));
+  }
+
+  static reg power_pairs(const double *p)
+  {
+    reg a = _mm_loadu_pd(p);     // re0 im0
+    reg b = _mm_loadu_pd(p + 2); // re1 im1
+    a = _mm_mul_pd(a, a);
+    b = _mm_mul_pd(b, b);
+    return _mm_add_pd(_mm_unpacklo_pd(a, b), _mm_unpackhi_pd(a, b));
+  }
+
+  // x = mantissa * 2^exponent, mantissa in [0.5, 1), for positive normal x.
+  static void split_exponent(reg x, reg & mantissa, reg & exponent)
+  {
+    const __m128i mantissa_bits = _mm_set1_epi64x(0x000FFFFFFFFFFFFFLL);
+    const __m128i half_bits = _mm_set1_epi64x(0x3FE0000000000000LL);
+    const reg two52 = _mm_set1_pd(4503599627370496.0);
+
+    __m128i bits = _mm_castpd_si128(x);
+    mantissa = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, mantissa_bits), half_bits));
+
+    // Biased exponent placed into the mantissa of 2^52 converts exactly.
+    __m128i biased = _mm_srli_epi64(bits, 52);
+    reg e = _mm_castsi128_pd(_mm_or_si128(biased, _mm_castpd_si128(two52)));
+    exponent = _mm_sub_pd(e, _mm_set1_pd(4503599627370496.0 + 1022.0));
+  }
+
+  static reg log(reg x) { return spectral_kernels_impl::cephes_log<sse2>(x); }
+};
+
+}
+
+const spectral_kernels & spectral_kernels_sse2()
+{
+  static const spectral_kernels kernels =
+      spectral_kernels_impl::make_kernels<sse2>("sse2");
+  return kernels;
+}
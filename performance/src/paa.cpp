@@ -66,8 +66,6 @@ Paa::~Paa()
 bool Paa::run(ostream &out)
 {
     uint32_t         uIndex;
-    float            fOnsetUpper;
-    float            fOnsetLower;
 	float            fDynamicUpper;
 	float            fDynamicLower;
 	float            fOnsetAccuracy;
@@ -149,46 +147,7 @@ bool Paa::run(ostream &out)
 	}
 
     // Match events by time and type
-
-    // Iterate over reference events
-    for (int referenceIndex = 0; referenceIndex < reference.size(); referenceIndex++)
-    {
-        trEvent & referenceEvent = reference[referenceIndex];
-
-        // Derive onset range
-        range(referenceEvent.fTimestamp, mfOnsetTolerance/1000.0f,
-              cfOnsetUpperLimit, cfOnsetLowerLimit, fOnsetUpper, fOnsetLower);
-
-        // Iterate over detected events
-        for (int detectedIndex = 0; detectedIndex < measure.size(); detectedIndex++)
-        {
-            trEvent & detectedEvent = measure[detectedIndex];
-
-            // Compare time
-            bool time_match =
-                    (detectedEvent.fTimestamp >= fOnsetLower) &&
-                    (detectedEvent.fTimestamp <= fOnsetUpper);
-            if (!time_match)
-                continue;
-
-            // Compare type
-            bool type_match = (referenceEvent.uType == detectedEvent.uType);
-
-            referenceEvent.bMatch = true;
-            referenceEvent.uReference = detectedIndex;
-
-            if (type_match)
-                break;
-        }
-
-        // Only update the best matched detected event
-        if (referenceEvent.bMatch)
-        {
-            trEvent & matchingDetectedEvent = measure[referenceEvent.uReference];
-            matchingDetectedEvent.bMatch = true;
-            matchingDetectedEvent.uReference = referenceIndex;
-        }
-    }
+    matchEvents(reference, measure, mfOnsetTolerance);
 
     // Count matches.
 
@@ -256,8 +215,11 @@ bool Paa::run(ostream &out)
     statistics stats;
     confusion_matrix matrix(map);
 
+    event_counts counts;
+
     stats.dynamics_accuracy = muOnsetMatch ? (float) muDynamicMatch / muOnsetMatch : 0;
-    computeStatistics(out, reference, measure, stats, matrix);
+    countEvents(reference, measure, counts, &matrix);
+    computeStatistics(counts, stats);
 
     out << "Onset:"
          << " A = " << stats.onset_accuracy * 100 << "%"
@@ -502,6 +464,53 @@ void Paa::acquireEvents(string name, vector<trEvent> &onset,
     delete pFile;
 }
 
+void Paa::matchEvents(vector<trEvent> &reference, vector<trEvent> &measure,
+                      float fOnsetTolerance)
+{
+    float fOnsetUpper;
+    float fOnsetLower;
+
+    // Iterate over reference events
+    for (int referenceIndex = 0; referenceIndex < reference.size(); referenceIndex++)
+    {
+        trEvent & referenceEvent = reference[referenceIndex];
+
+        // Derive onset range
+        range(referenceEvent.fTimestamp, fOnsetTolerance/1000.0f,
+              cfOnsetUpperLimit, cfOnsetLowerLimit, fOnsetUpper, fOnsetLower);
+
+        // Iterate over detected events
+        for (int detectedIndex = 0; detectedIndex < measure.size(); detectedIndex++)
+        {
+            trEvent & detectedEvent = measure[detectedIndex];
+
+            // Compare time
+            bool time_match =
+                    (detectedEvent.fTimestamp >= fOnsetLower) &&
+                    (detectedEvent.fTimestamp <= fOnsetUpper);
+            if (!time_match)
+                continue;
+
+            // Compare type
+            bool type_match = (referenceEvent.uType == detectedEvent.uType);
+
+            referenceEvent.bMatch = true;
+            referenceEvent.uReference = detectedIndex;
+
+            if (type_match)
+                break;
+        }
+
+        // Only update the best matched detected event
+        if (referenceEvent.bMatch)
+        {
+            trEvent & matchingDetectedEvent = measure[referenceEvent.uReference];
+            matchingDetectedEvent.bMatch = true;
+            matchingDetectedEvent.uReference = referenceIndex;
+        }
+    }
+}
+
 void Paa::range(float fValue, float fTolerance, float fUpperLimit,
                float fLowerLimit, float &fUpper, float &fLower)
 {
@@ -577,13 +586,13 @@ void Paa::confusion_matrix::print( std::ostream & out )
     out << endl;
 }
 
-void Paa::computeStatistics(ostream &out, vector<trEvent> &reference,
-                           vector<trEvent> &measure,
-                           statistics & stats,
-                           confusion_matrix & matrix)
+void Paa::countEvents(vector<trEvent> &reference,
+                      vector<trEvent> &measure,
+                      event_counts &counts,
+                      confusion_matrix *matrix)
 {
-    int total_cols = matrix.column_count();
-    int total_rows = matrix.row_count();
+    int total_cols = matrix ? matrix->column_count() : 2;
+    int total_rows = matrix ? matrix->row_count() : 2;
 
     int unmapped_col = total_cols - 2;
     int missed_col = total_cols - 1;
@@ -601,14 +610,14 @@ void Paa::computeStatistics(ostream &out, vector<trEvent> &reference,
         int col = missed_col;
 
         trEvent & refEvent = reference[refIndex];
-        row = matrix.typeIndex(refEvent.uType);
+        row = matrix ? matrix->typeIndex(refEvent.uType) : -1;
         if (row == -1)
             row = unmapped_row;
 
         if (refEvent.bMatch)
         {
             trEvent & detectedEvent = measure[refEvent.uReference];
-            col = matrix.typeIndex(detectedEvent.uType);
+            col = matrix ? matrix->typeIndex(detectedEvent.uType) : -1;
             if (col == -1)
                 col = unmapped_col;
 
@@ -622,7 +631,8 @@ void Paa::computeStatistics(ostream &out, vector<trEvent> &reference,
           missed_count++;
         }
 
-        matrix.data[row][col]++;
+        if (matrix)
+            matrix->data[row][col]++;
     }
 
     for (int detIndex = 0; detIndex < measure.size(); ++detIndex)
@@ -630,16 +640,30 @@ void Paa::computeStatistics(ostream &out, vector<trEvent> &reference,
         trEvent & detectedEvent = measure[detIndex];
         if (!detectedEvent.bMatch)
         {
-            int col = matrix.typeIndex(detectedEvent.uType);
+            int col = matrix ? matrix->typeIndex(detectedEvent.uType) : -1;
             if (col == -1)
                 col = unmapped_col;
 
-            matrix.data[ghost_row][col]++;
+            if (matrix)
+                matrix->data[ghost_row][col]++;
 
             ghost_count++;
         }
     }
 
+    counts.detected = detected_count;
+    counts.misdetected = misdetected_count;
+    counts.missed = missed_count;
+    counts.ghost = ghost_count;
+}
+
+void Paa::computeStatistics(const event_counts &counts, statistics &stats)
+{
+    unsigned int detected_count = counts.detected;
+    unsigned int misdetected_count = counts.misdetected;
+    unsigned int missed_count = counts.missed;
+    unsigned int ghost_count = counts.ghost;
+
     int total_count = detected_count + misdetected_count + missed_count + ghost_count;
 
     stats.onset_accuracy =
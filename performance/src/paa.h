@@ -47,8 +47,6 @@ public:
     bool run(ostream &out);
     void usage(ostream &out);
 
-private:
-
     // Structure[s]
     typedef struct
     {
@@ -122,6 +120,14 @@ private:
         }
     };
 
+    struct event_counts
+    {
+        uint32_t detected;
+        uint32_t misdetected;
+        uint32_t missed;
+        uint32_t ghost;
+    };
+
     struct statistics
     {
       float onset_accuracy;
@@ -154,16 +160,25 @@ private:
         void print( std::ostream & out );
     };
 
+    // Static Method[s]
+    static bool acquireMap(string name, vector<trMap> &map);
+    static void acquireEvents(string name, vector<trEvent> &onset,
+                              const type_map &, bool do_map);
+    static void matchEvents(vector<trEvent> &reference,
+                            vector<trEvent> &measure,
+                            float fOnsetTolerance);
+    static void countEvents(vector<trEvent> &reference,
+                            vector<trEvent> &measure,
+                            event_counts &counts,
+                            confusion_matrix *matrix);
+    static void computeStatistics(const event_counts &counts,
+                                  statistics &stats);
+
+private:
+
     // Method[s]
-    bool acquireMap(string name, vector<trMap> &map);
-    void acquireEvents(string name, vector<trEvent> &onset,
-                       const type_map &, bool do_map);
-    void range(float fValue, float fTolerance, float fUpperLimit,
-               float fLowerLimit, float &fUpper, float &fLower);
-    void computeStatistics(ostream &out, vector<trEvent> &reference,
-                           vector<trEvent> &measure,
-                           statistics & stats,
-                           confusion_matrix & matrix);
+    static void range(float fValue, float fTolerance, float fUpperLimit,
+                      float fLowerLimit, float &fUpper, float &fLower);
 
 
 
@@ -6,27 +6,8 @@ if [ -z $root_dir ] || [ -z $detector ]; then
   exit 1
 fi
 
-shopt -s globstar
-for file in $root_dir/**
-do
-  #echo "File: $file"
-  if [[ $file =~ .*\.wav ]]
-  then
-    dir=`dirname "$file"`
-    #echo "Dir: $dir"
-    if [[ $dir =~ $root_dir/(.*) ]]
-    then
-      out_dir=${BASH_REMATCH[1]}
-    else
-      echo "Could not get relative dir"
-      exit 1
-    fi
-    #echo "Output dir: $out_dir"
-
-    mkdir -p "$out_dir"
-    out_file="$out_dir/`basename "$file" .wav`.onsets"
-    cmd="$detector \"$file\" \"$out_file\""
-    echo $cmd
-    $detector "$file" "$out_file"
-  fi
-done
+# Process all .wav files under root_dir in a single detector process,
+# writing .onsets files at the same relative paths under the current dir.
+cmd="$detector -j `nproc` -d \"$root_dir\" -o ."
+echo $cmd
+$detector -j `nproc` -d "$root_dir" -o .
@@ -0,0 +1,320 @@
+#include "vamp_marsyas_plugin.hpp"
+#include "marsystems.hpp"
+
+#include <marsyas/system/MarSystemManager.h>
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <new>
+#include <cstdlib>
+#include <algorithm>
+
+//FIXME: Only on POSIX:
+#include <unistd.h>
+
+using namespace std;
+using namespace Marsyas;
+
+// Runs a Vamp script plugin on noise and reports the heap allocations
+// and time per steady-state process() call. Fails if the in-place
+// processing path allocates, or if process() - what hosts call - makes
+// more allocations than its returned copy needs: the map node, the
+// feature list and one value vector per feature.
+// With -v, it first checks that an instance, cloned from the script's
+// prototype, gives the same output as one from a new translation.
+
+static size_t allocation_count = 0;
+
+void * operator new(size_t size)
+{
+  ++allocation_count;
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+static void print_usage()
+{
+  cerr << "Usage: vamp_process_benchmark [options] <script>" << endl
+       << "Options:" << endl
+       << "  -n <count>  Number of blocks measured (default: 10000)." << endl
+       << "  -b <size>   Block size (default: the plugin's preferred size)." << endl
+       << "  -s <size>   Step size (default: the plugin's preferred size)." << endl
+       << "  -c <count>  Number of channels (default: 1)." << endl
+       << "  -v          First check that the plugin gives the same output as one" << endl
+       << "              initialised from a new translation of the script, with" << endl
+       << "              each non-quantized parameter changed from its default." << endl;
+}
+
+static bool same_features(const Vamp::Plugin::FeatureSet & a,
+                          const Vamp::Plugin::FeatureSet & b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  Vamp::Plugin::FeatureSet::const_iterator ia = a.begin(), ib = b.begin();
+  for (; ia != a.end(); ++ia, ++ib)
+  {
+    const Vamp::Plugin::FeatureList & la = ia->second;
+    const Vamp::Plugin::FeatureList & lb = ib->second;
+    if (ia->first != ib->first || la.size() != lb.size())
+      return false;
+
+    for (size_t i = 0; i < la.size(); ++i)
+    {
+      if (la[i].hasTimestamp != lb[i].hasTimestamp ||
+          (la[i].hasTimestamp && la[i].timestamp != lb[i].timestamp) ||
+          la[i].values != lb[i].values)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+// Runs 'plugin' and 'reference' on the same noise bursts and compares
+// every output. Both are initialised with the given formats.
+static bool verify(VampPlugin & plugin, VampPlugin & reference, long blocks,
+                   size_t channels, size_t step_size, size_t block_size,
+                   size_t buffer_size)
+{
+  Vamp::Plugin::ParameterList params = plugin.getParameterDescriptors();
+  for (size_t i = 0; i < params.size(); ++i)
+  {
+    if (params[i].isQuantized)
+      continue;
+    float value = params[i].defaultValue * 1.25f + 0.1f;
+    plugin.setParameter(params[i].identifier, value);
+    reference.setParameter(params[i].identifier, value);
+  }
+
+  if (!plugin.initialise(channels, step_size, block_size) ||
+      !reference.initialiseTranslated(channels, step_size, block_size))
+  {
+    cerr << "Failure: Could not initialise plugins for comparison." << endl;
+    return false;
+  }
+
+  Vamp::Plugin::OutputDescriptor out = plugin.getOutputDescriptors()[0];
+  Vamp::Plugin::OutputDescriptor expected = reference.getOutputDescriptors()[0];
+  if (out.binCount != expected.binCount || out.sampleRate != expected.sampleRate)
+  {
+    cerr << "Failure: Output format differs from a new translation: "
+         << out.binCount << " bins @ " << out.sampleRate << " instead of "
+         << expected.binCount << " bins @ " << expected.sampleRate << endl;
+    return false;
+  }
+
+  vector< vector<float> > input(channels, vector<float>(buffer_size));
+  vector<const float*> buffers(channels);
+  for (size_t c = 0; c < channels; ++c)
+    buffers[c] = input[c].data();
+
+  mt19937 random(2);
+  uniform_real_distribution<float> noise(-1.f, 1.f);
+  uniform_int_distribution<int> burst(0, 7);
+
+  size_t event_count = 0;
+
+  for (long b = 0; b < blocks; ++b)
+  {
+    // Mostly quiet, with occasional loud blocks, so there are onsets.
+    float gain = burst(random) ? 0.05f : 1.f;
+    for (size_t c = 0; c < channels; ++c)
+      for (size_t s = 0; s < buffer_size; ++s)
+        input[c][s] = gain * noise(random);
+
+    Vamp::RealTime time = Vamp::RealTime::frame2RealTime(b * step_size, 44100);
+
+    const Vamp::Plugin::FeatureSet & features = plugin.processInPlace(buffers.data(), time);
+    const Vamp::Plugin::FeatureSet & expected_features =
+        reference.processInPlace(buffers.data(), time);
+
+    if (!same_features(features, expected_features))
+    {
+      cerr << "Failure: Output of block " << b
+           << " differs from a new translation." << endl;
+      return false;
+    }
+
+    if (!features.empty())
+      event_count += features.begin()->second.size();
+  }
+
+  cout << "Same output as a new translation for " << blocks << " blocks ("
+       << event_count << " features)." << endl;
+
+  return true;
+}
+
+struct measurement
+{
+  double allocations;
+  size_t max_allocations;
+  double nanoseconds;
+};
+
+template <typename F>
+static measurement measure(long blocks, F f)
+{
+  typedef chrono::steady_clock clock_type;
+
+  // Warm up: the first calls may size internal buffers.
+  for (long i = 0; i < blocks / 10 + 1; ++i)
+    f();
+
+  size_t max_allocations = 0;
+  size_t allocations = allocation_count;
+  clock_type::time_point start = clock_type::now();
+  for (long i = 0; i < blocks; ++i)
+  {
+    size_t before = allocation_count;
+    f();
+    max_allocations = max(max_allocations, allocation_count - before);
+  }
+  clock_type::time_point end = clock_type::now();
+  allocations = allocation_count - allocations;
+
+  measurement m;
+  m.allocations = (double) allocations / blocks;
+  m.max_allocations = max_allocations;
+  m.nanoseconds = chrono::duration<double, nano>(end - start).count() / blocks;
+  return m;
+}
+
+int main(int argc, char *argv[])
+{
+  long blocks = 10000;
+  size_t block_size = 0;
+  size_t step_size = 0;
+  size_t channels = 1;
+  bool verify_clone = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:b:s:c:v")) != -1)
+  {
+    switch(opt)
+    {
+    case 'n':
+      blocks = atol(optarg);
+      break;
+    case 'b':
+      block_size = atol(optarg);
+      break;
+    case 's':
+      step_size = atol(optarg);
+      break;
+    case 'c':
+      channels = atol(optarg);
+      break;
+    case 'v':
+      verify_clone = true;
+      break;
+    default:
+      print_usage();
+      return 1;
+    }
+  }
+
+  if (optind != argc - 1 || blocks < 1 || channels < 1)
+  {
+    print_usage();
+    return 1;
+  }
+
+  string filename(argv[optind]);
+  float sample_rate = 44100.f;
+
+  MarSystemManager manager;
+  register_shared_marsystems(&manager);
+  VampScript script(filename, &manager);
+  VampPlugin plugin(&script, sample_rate);
+
+  if (!block_size)
+    block_size = plugin.getPreferredBlockSize();
+  if (!step_size)
+    step_size = plugin.getPreferredStepSize();
+
+  // A spectrum holds (re, im) of block_size / 2 + 1 bins.
+  size_t buffer_size = block_size;
+  if (plugin.getInputDomain() == Vamp::Plugin::FrequencyDomain)
+    buffer_size = block_size + 2;
+
+  if (verify_clone)
+  {
+    VampPlugin reference(&script, sample_rate);
+    if (!verify(plugin, reference, blocks, channels, step_size, block_size, buffer_size))
+      return 1;
+  }
+
+  if (!plugin.initialise(channels, step_size, block_size))
+  {
+    cerr << "Failed to initialise plugin with script: " << filename << endl;
+    return 1;
+  }
+
+  vector< vector<float> > input(channels, vector<float>(buffer_size));
+  vector<const float*> buffers(channels);
+  mt19937 random(1);
+  uniform_real_distribution<float> noise(-1.f, 1.f);
+  for (size_t c = 0; c < channels; ++c)
+  {
+    for (size_t s = 0; s < buffer_size; ++s)
+      input[c][s] = noise(random);
+    buffers[c] = input[c].data();
+  }
+
+  Vamp::RealTime time;
+
+  measurement in_place = measure(blocks, [&]()
+  {
+    plugin.processInPlace(buffers.data(), time);
+  });
+
+  measurement by_value = measure(blocks, [&]()
+  {
+    plugin.process(buffers.data(), time);
+  });
+
+  // At most one feature per output frame, for which the storage is
+  // reserved; with event output, fewer features may be returned.
+  const Vamp::Plugin::FeatureSet & features = plugin.processInPlace(buffers.data(), time);
+  size_t max_features = features.empty() ? 0 : features.begin()->second.capacity();
+  size_t allocation_bound = 2 + max_features;
+
+  cout << "Per block of " << block_size << " x " << channels << ":" << endl
+       << "  processInPlace: " << in_place.allocations << " allocations (max "
+       << in_place.max_allocations << "), "
+       << in_place.nanoseconds << " ns" << endl
+       << "  process:        " << by_value.allocations << " allocations (max "
+       << by_value.max_allocations << ", bound " << allocation_bound << "), "
+       << by_value.nanoseconds << " ns" << endl;
+
+  bool ok = true;
+
+  if (in_place.max_allocations > 0)
+  {
+    cerr << "Failure: processInPlace allocates memory." << endl;
+    ok = false;
+  }
+
+  if (by_value.max_allocations > allocation_bound)
+  {
+    cerr << "Failure: process makes more than " << allocation_bound
+         << " allocations per call." << endl;
+    ok = false;
+  }
+
+  if (!ok)
+    return 1;
+
+  return 0;
+}
@@ -3,9 +3,9 @@
 #endif
 
 #include "vamp_marsyas_plugin.hpp"
+#include "marsystems.hpp"
 
 #include <marsyas/system/MarSystemManager.h>
-#include <marsyas/script/script.h>
 
 #include <vamp-sdk/PluginAdapter.h>
 
@@ -24,96 +24,59 @@ using namespace std;
 
 namespace Marsyas {
 
+static bool is_non_zero(mrs_real value)
+{
+  return value != 0.0;
+}
+
 static MarSystemManager *get_marsystem_manager()
 {
   static MarSystemManager *manager = 0;
   if (!manager)
   {
     manager = new MarSystemManager;
+    register_shared_marsystems(manager);
   }
   return manager;
 }
 
 class VampPluginAdapter: public Vamp::PluginAdapterBase
 {
-  string m_script;
-  MarSystem *m_prototype;
+  VampScript m_script;
 
 public:
-  VampPluginAdapter(const string & script): m_script(script)
-  {
-    m_prototype = system_from_script(m_script, get_marsystem_manager());
-    if (!m_prototype)
-    {
-      cerr << "ERROR: Failed to create prototype for script: " << m_script << endl;
-    }
-  }
-
-  ~VampPluginAdapter()
-  {
-    delete m_prototype;
-  }
+  VampPluginAdapter(const string & script, VampDescriptionCache *cache):
+    m_script(script, get_marsystem_manager(), cache)
+  {}
 
 private:
   virtual Vamp::Plugin * createPlugin (float inputSampleRate)
   {
-    return new Marsyas::VampPlugin(m_script, m_prototype, inputSampleRate);
+    return new Marsyas::VampPlugin(&m_script, inputSampleRate);
   }
 };
 
-VampPlugin::VampPlugin(const string & script, MarSystem * prototype, float inputSampleRate):
+VampPlugin::VampPlugin(VampScript *script, float inputSampleRate):
     Vamp::Plugin(inputSampleRate),
-    m_script_filename(script),
-    m_prototype(prototype),
+    m_script(script),
+    m_input_domain(TimeDomain),
+    m_output_events(false),
     m_input_sample_rate(inputSampleRate),
     m_channels(0),
     m_block_size(0),
     m_step_size(0),
     m_system(0)
 {
-  discoverParameters();
-}
+  // From the description cache if possible, without translating the script.
+  const VampScriptDescription & description = m_script->description();
 
-void VampPlugin::discoverParameters()
-{
-  if (!m_prototype)
-  {
-    cerr << "WARNING: Missing prototype!" << endl;
-    return;
-  }
+  m_input_domain = description.input_domain;
+  m_output_events = description.events;
+  m_param_descriptors = description.parameters;
 
-  const std::map<std::string, MarControlPtr> & controls = m_prototype->controls();
-  std::map<std::string, MarControlPtr>::const_iterator it;
-  for (it = controls.begin(); it != controls.end(); ++it)
+  for (size_t i = 0; i < m_param_descriptors.size(); ++i)
   {
-    const MarControlPtr & control = it->second;
-
-    assert(!control.isInvalid());
-
-    if (!control->isPublic())
-      continue;
-
-    ParameterDescriptor param;
-    if (control->hasType<mrs_real>())
-    {
-      param.defaultValue = (float) control->to<mrs_real>();
-    }
-    else if (control->hasType<mrs_natural>())
-    {
-      param.isQuantized = true;
-      param.quantizeStep = 1.0f;
-      param.defaultValue = (float) control->to<mrs_natural>();
-    }
-    else
-    {
-      continue;
-    }
-    param.identifier = param.name = control->id();
-    param.minValue = -10000.f;
-    param.maxValue = 10000.f;
-
-    m_param_descriptors.push_back(param);
-
+    const ParameterDescriptor & param = m_param_descriptors[i];
     m_params[param.identifier] = param.defaultValue;
   }
 }
@@ -125,7 +88,7 @@ VampPlugin::~VampPlugin()
 
 string VampPlugin::getIdentifier() const
 {
-  string id(m_script_filename);
+  string id(m_script->filename());
   replace(id.begin(), id.end(), '/', '.');
   replace(id.begin(), id.end(), ' ', '.');
   return string("marsyas.") + id;
@@ -133,7 +96,7 @@ string VampPlugin::getIdentifier() const
 
 string VampPlugin::getName() const
 {
-    return string("Marsyas: ") + m_script_filename;
+    return string("Marsyas: ") + m_script->filename();
 }
 
 string VampPlugin::getDescription() const
@@ -159,7 +122,7 @@ int VampPlugin::getPluginVersion() const
 
 Vamp::Plugin::InputDomain VampPlugin::getInputDomain() const
 {
-    return TimeDomain;
+    return m_input_domain;
 }
 
 size_t VampPlugin::getMinChannelCount() const
@@ -174,7 +137,9 @@ size_t VampPlugin::getMaxChannelCount() const
 
 size_t VampPlugin::getPreferredBlockSize() const
 {
-    return 512;
+    // Spectrum scripts get the window of 2 hops that time domain
+    // scripts assemble with ShiftInput.
+    return m_input_domain == FrequencyDomain ? 1024 : 512;
 }
 
 size_t VampPlugin::getPreferredStepSize() const
@@ -211,7 +176,9 @@ Vamp::Plugin::OutputList VampPlugin::getOutputDescriptors() const
     OutputDescriptor out;
     out.identifier = "output";
     out.name = "Output";
-    out.sampleType = OutputDescriptor::FixedSampleRate;
+    // Events have a timestamp each, at the resolution of the frame rate.
+    out.sampleType = m_output_events ?
+          OutputDescriptor::VariableSampleRate : OutputDescriptor::FixedSampleRate;
     out.hasFixedBinCount = true;
     if (m_system)
     {
@@ -231,17 +198,32 @@ Vamp::Plugin::OutputList VampPlugin::getOutputDescriptors() const
 }
 
 bool VampPlugin::initialise(size_t channels, size_t stepSize, size_t blockSize)
+{
+  // The script is translated once, when the first instance needs it.
+  // Formats and parameters are applied to the clone in setup();
+  // "vamp_process_benchmark -v" checks that its link and expression
+  // controls (e.g. winSize = 2 * /inSamples) follow them.
+  MarSystem *prototype = m_script->prototype();
+  return setup(prototype ? prototype->clone() : 0, channels, stepSize, blockSize);
+}
+
+bool VampPlugin::initialiseTranslated(size_t channels, size_t stepSize, size_t blockSize)
+{
+  return setup(m_script->translate(), channels, stepSize, blockSize);
+}
+
+bool VampPlugin::setup(MarSystem *system,
+                       size_t channels, size_t stepSize, size_t blockSize)
 {
   delete m_system;
+  m_system = system;
 
   m_channels = channels;
   m_step_size = stepSize;
   m_block_size = blockSize;
 
-  m_system = system_from_script(m_script_filename, get_marsystem_manager());
-
   if (!m_system)
-    return 0;
+    return false;
 
   cout << "Input format = "
        << channels
@@ -250,9 +232,20 @@ bool VampPlugin::initialise(size_t channels, size_t stepSize, size_t blockSize)
        << " @ " << m_input_sample_rate
        << endl;
 
-  m_system->updControl("mrs_real/israte", (mrs_real) m_input_sample_rate);
-  m_system->updControl("mrs_natural/inObservations", (mrs_natural) channels);
-  m_system->updControl("mrs_natural/inSamples", (mrs_natural) blockSize);
+  if (m_input_domain == FrequencyDomain)
+  {
+    // One packed spectrum of 'blockSize' samples per call, as output
+    // by Spectrum, and at the same rate.
+    m_system->updControl("mrs_real/israte", (mrs_real) m_input_sample_rate / blockSize);
+    m_system->updControl("mrs_natural/inObservations", (mrs_natural) blockSize);
+    m_system->updControl("mrs_natural/inSamples", (mrs_natural) 1);
+  }
+  else
+  {
+    m_system->updControl("mrs_real/israte", (mrs_real) m_input_sample_rate);
+    m_system->updControl("mrs_natural/inObservations", (mrs_natural) channels);
+    m_system->updControl("mrs_natural/inSamples", (mrs_natural) blockSize);
+  }
 
   applyParameters(m_system);
 
@@ -265,9 +258,26 @@ bool VampPlugin::initialise(size_t channels, size_t stepSize, size_t blockSize)
        << " @ " << m_system->getControl("mrs_real/osrate")->to<mrs_real>()
        << endl;
 
-  m_input.create(m_channels, m_block_size);
+  if (m_input_domain == FrequencyDomain)
+    m_input.create(m_block_size, 1);
+  else
+    m_input.create(m_channels, m_block_size);
   m_output.create(m_out_observations, m_out_samples);
 
+  m_feature_set.clear();
+  FeatureList & features = m_feature_set[0];
+  if (m_output_events)
+  {
+    features.reserve(m_out_samples);
+    m_event_values.assign(m_out_samples, vector<float>(m_out_observations));
+  }
+  else
+  {
+    features.resize(m_out_samples);
+    for (size_t s = 0; s < features.size(); ++s)
+      features[s].values.resize(m_out_observations);
+  }
+
   return true;
 }
 
@@ -304,38 +314,145 @@ void VampPlugin::applyParameters(MarSystem *system)
 
 void VampPlugin::reset()
 {
-  initialise(m_channels, m_step_size, m_block_size);
+  if (!m_system)
+    return;
+
+  // Keep the graph and buffers; only clear what carries over between
+  // blocks. Parameters set since initialise() take effect too.
+  applyParameters(m_system);
+  reset_state(m_system);
 }
 
 Vamp::Plugin::FeatureSet VampPlugin::process(const float *const *inputBuffers, Vamp::RealTime timeStamp)
 {
-  Vamp::Plugin::FeatureSet feature_set;
-  Vamp::Plugin::FeatureList feature_list;
+  // The Vamp API returns features by value, so the copy allocates on
+  // every call: the map node, the list, and one vector of exactly
+  // binCount values per feature. Nothing else does; process_benchmark
+  // fails beyond that bound.
+  return processInPlace(inputBuffers, timeStamp);
+}
+
+const Vamp::Plugin::FeatureSet &
+VampPlugin::processInPlace(const float *const *inputBuffers, Vamp::RealTime timeStamp)
+{
+  if (m_input_domain == FrequencyDomain)
+    readSpectrum(inputBuffers);
+  else
+    readSamples(inputBuffers);
+
+  m_system->process(m_input, m_output);
+
+  if (m_output_events)
+    writeEvents(timeStamp);
+  else
+    writeFrames();
 
-  for(mrs_natural c = 0; c < m_channels; ++c)
+  return m_feature_set;
+}
+
+void VampPlugin::writeFrames()
+{
+  // Bins of one output frame are contiguous.
+  const mrs_real *output = m_output.getData();
+  size_t bin_count = m_output.getRows();
+  FeatureList & features = m_feature_set[0];
+  assert(features.size() == (size_t) m_output.getCols());
+
+  for(size_t s = 0; s < features.size(); ++s)
   {
-    for(mrs_natural s = 0; s < m_block_size; ++s)
-    {
-      m_input(c,s) = inputBuffers[c][s];
-    }
+    const mrs_real *frame = output + s * bin_count;
+    std::copy(frame, frame + bin_count, features[s].values.begin());
   }
+}
 
-  m_system->process(m_input, m_output);
+void VampPlugin::writeEvents(Vamp::RealTime timeStamp)
+{
+  const mrs_real *output = m_output.getData();
+  size_t bin_count = m_output.getRows();
+  size_t frame_count = m_output.getCols();
+  FeatureList & events = m_feature_set[0];
+  assert(m_event_values.size() == frame_count);
+
+  // Take back the values lent to the last events. The list keeps its
+  // capacity and emptied features own no memory, so nothing is freed
+  // or allocated.
+  for(size_t i = 0; i < events.size(); ++i)
+    events[i].values.swap(m_event_values[i]);
+  events.clear();
+
+  if (frame_count == 0)
+    return;
+
+  size_t hop = m_step_size / frame_count;
+  unsigned int sample_rate = (unsigned int) (m_input_sample_rate + 0.5f);
 
-  for(mrs_natural s = 0; s < m_output.getCols(); ++s)
+  for(size_t s = 0; s < frame_count; ++s)
   {
-    Feature features;
-    for(mrs_natural o = 0; o < m_output.getRows(); ++o)
-    {
-      features.values.push_back( (float) m_output(o,s) );
-    }
+    const mrs_real *frame = output + s * bin_count;
+    const mrs_real *frame_end = frame + bin_count;
+    if (std::find_if(frame, frame_end, is_non_zero) == frame_end)
+      continue;
+
+    events.push_back(Feature());
+    Feature & event = events.back();
+    event.values.swap(m_event_values[events.size() - 1]);
+    std::copy(frame, frame_end, event.values.begin());
+    event.hasTimestamp = true;
+    event.timestamp = timeStamp + Vamp::RealTime::frame2RealTime(s * hop, sample_rate);
+  }
+}
 
-    feature_list.push_back(features);
+void VampPlugin::readSamples(const float *const *inputBuffers)
+{
+  // realvec is column-major: the samples of one channel are
+  // 'm_channels' apart.
+  mrs_real *input = m_input.getData();
+  if (m_channels == 1)
+  {
+    std::copy(inputBuffers[0], inputBuffers[0] + m_block_size, input);
+    return;
   }
 
-  feature_set[0] = feature_list;
+  for(size_t c = 0; c < m_channels; ++c)
+  {
+    const float *channel = inputBuffers[c];
+    mrs_real *out = input + c;
+    for(size_t s = 0; s < m_block_size; ++s)
+      out[s * m_channels] = channel[s];
+  }
+}
 
-  return feature_set;
+void VampPlugin::readSpectrum(const float *const *inputBuffers)
+{
+  // The host gives (re, im) of bins 0 to n/2. The packed format of
+  // Spectrum has bins 1 to n/2-1 at the same positions, and Re(n/2)
+  // in place of Im(0), which is always 0.
+  // The host's FFT is unnormalised, while Spectrum scales its output
+  // down by n, so the bins are scaled to match: scale-dependent
+  // systems such as LogMagnitude (log(1 + |X|)) then see the same range.
+  // Differences remain: the host applies its own window (Hann) instead
+  // of Windowing's, and shifts the frame before the transform, which
+  // changes the phases but not the magnitudes.
+  // Channels are averaged, as by MixToMono before the transform.
+
+  mrs_real *spectrum = m_input.getData();
+  size_t n = m_block_size;
+
+  const float *bins = inputBuffers[0];
+  std::copy(bins, bins + n, spectrum);
+  spectrum[1] = bins[n];
+
+  for(size_t c = 1; c < m_channels; ++c)
+  {
+    bins = inputBuffers[c];
+    for(size_t i = 0; i < n; ++i)
+      spectrum[i] += bins[i];
+    spectrum[1] += bins[n] - bins[1];
+  }
+
+  mrs_real scale = 1.0 / ((mrs_real) n * m_channels);
+  for(size_t i = 0; i < n; ++i)
+    spectrum[i] *= scale;
 }
 
 Vamp::Plugin::FeatureSet VampPlugin::getRemainingFeatures()
@@ -372,6 +489,8 @@ std::vector<string> find_scripts()
   std::string script_location( MARSYAS_SCRIPT_DIR "/vamp" );
   std::vector<string> scripts;
   get_dir_entries(script_location, scripts);
+  // Stable plugin indexes across runs.
+  std::sort(scripts.begin(), scripts.end());
   return scripts;
 }
 
@@ -381,28 +500,33 @@ const VampPluginDescriptor *vampGetPluginDescriptor
   if (version < 1) return 0;
 
   static bool discovery_done = false;
+  static std::vector<string> scripts;
   static std::vector<Marsyas::VampPluginAdapter*> plugins;
+  static Marsyas::VampDescriptionCache *cache = 0;
 
+  // Only lists the script directory. Adapters are created for the
+  // requested plugins only, and their scripts are translated only
+  // when described without a cache entry, or instantiated.
   if (!discovery_done)
   {
     cout << "Discovering Marsyas scripts..." << endl;
-    std::vector<string> scripts( find_scripts() );
-    for(int i = 0; i < scripts.size(); ++i)
-    {
-      const string & script = scripts[i];
-      cout << "Found Marsyas script: " << script << endl;
-      plugins.push_back(new Marsyas::VampPluginAdapter(script));
-    }
+    scripts = find_scripts();
+    for(size_t i = 0; i < scripts.size(); ++i)
+      cout << "Found Marsyas script: " << scripts[i] << endl;
     cout << "Discovering Marsyas scripts done." << endl;
 
+    plugins.resize(scripts.size(), 0);
+    cache = new Marsyas::VampDescriptionCache
+        (Marsyas::VampDescriptionCache::defaultFilename());
+
     discovery_done = true;
   }
 
-  if (index < plugins.size())
-  {
-    return plugins[index]->getDescriptor();
-  }
+  if (index >= plugins.size())
+    return 0;
 
-  return 0;
-}
+  if (!plugins[index])
+    plugins[index] = new Marsyas::VampPluginAdapter(scripts[index], cache);
 
+  return plugins[index]->getDescriptor();
+}
@@ -1,6 +1,8 @@
 #ifndef VAMP_MARSYAS_PLUGIN_INCLUDED
 #define VAMP_MARSYAS_PLUGIN_INCLUDED
 
+#include "vamp_script.hpp"
+
 #include <vamp-sdk/Plugin.h>
 #include <marsyas/system/MarSystem.h>
 #include <map>
@@ -11,10 +13,13 @@ class VampPlugin : public Vamp::Plugin
 {
 
 public:
-    VampPlugin(const std::string & script, MarSystem *prototype, float inputSampleRate);
+    VampPlugin(VampScript *script, float inputSampleRate);
     virtual ~VampPlugin();
 
     bool initialise(size_t channels, size_t stepSize, size_t blockSize);
+    // Same as initialise(), but from a new translation of the script
+    // instead of a clone of its prototype. For checking the clones.
+    bool initialiseTranslated(size_t channels, size_t stepSize, size_t blockSize);
     void reset();
 
     std::string getIdentifier() const;
@@ -39,14 +44,25 @@ public:
     FeatureSet process(const float *const *inputBuffers,
                        Vamp::RealTime timestamp);
 
+    // Same as process(), but returns storage owned by the plugin, valid
+    // until the next call. Does not allocate memory.
+    const FeatureSet & processInPlace(const float *const *inputBuffers,
+                                      Vamp::RealTime timestamp);
+
     FeatureSet getRemainingFeatures();
 
 private:
-    void discoverParameters();
+    // Takes ownership of 'system' (0 fails) and applies the formats.
+    bool setup(MarSystem *system, size_t channels, size_t stepSize, size_t blockSize);
     void applyParameters(MarSystem *system);
+    void readSamples(const float *const *inputBuffers);
+    void readSpectrum(const float *const *inputBuffers);
+    void writeFrames();
+    void writeEvents(Vamp::RealTime timestamp);
 
-    std::string m_script_filename;
-    MarSystem * m_prototype;
+    VampScript *m_script;
+    InputDomain m_input_domain;
+    bool m_output_events;
 
     ParameterList m_param_descriptors;
     std::map<std::string, float> m_params;
@@ -57,6 +73,10 @@ private:
     MarSystem *m_system;
     realvec m_input;
     realvec m_output;
+    // Preallocated in initialise() to the output format.
+    FeatureSet m_feature_set;
+    // Values of events, lent to the features of the last output.
+    std::vector< std::vector<float> > m_event_values;
 };
 
 } // namespace Marsyas
@@ -0,0 +1,314 @@
+#include "vamp_script.hpp"
+
+#include <marsyas/script/script.h>
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstdio>
+#include <cassert>
+
+//FIXME: Only on POSIX:
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace Marsyas {
+
+static const char *cache_header = "marsyas-vamp-descriptions 2";
+
+static Vamp::Plugin::ParameterDescriptor make_parameter(const string & id,
+                                                        float default_value,
+                                                        bool quantized)
+{
+  Vamp::Plugin::ParameterDescriptor param;
+  param.identifier = param.name = id;
+  param.defaultValue = default_value;
+  param.minValue = -10000.f;
+  param.maxValue = 10000.f;
+  if (quantized)
+  {
+    param.isQuantized = true;
+    param.quantizeStep = 1.0f;
+  }
+  return param;
+}
+
+static void describe(MarSystem *prototype, VampScriptDescription & description)
+{
+  // Scripts taking a spectrum declare:  + input_domain = "frequency"
+  MarControlPtr domain_control = prototype->control("input_domain");
+  if (!domain_control.isInvalid())
+  {
+    mrs_string domain = domain_control->to<mrs_string>();
+    if (domain == "frequency")
+      description.input_domain = Vamp::Plugin::FrequencyDomain;
+    else if (domain != "time")
+      cerr << "WARNING: Invalid input domain: " << domain << endl;
+  }
+
+  // Scripts outputting sparse events declare:  + output_type = "events"
+  MarControlPtr output_control = prototype->control("output_type");
+  if (!output_control.isInvalid())
+  {
+    mrs_string output_type = output_control->to<mrs_string>();
+    if (output_type == "events")
+      description.events = true;
+    else if (output_type != "frames")
+      cerr << "WARNING: Invalid output type: " << output_type << endl;
+  }
+
+  const std::map<std::string, MarControlPtr> & controls = prototype->controls();
+  std::map<std::string, MarControlPtr>::const_iterator it;
+  for (it = controls.begin(); it != controls.end(); ++it)
+  {
+    const MarControlPtr & control = it->second;
+
+    assert(!control.isInvalid());
+
+    if (!control->isPublic())
+      continue;
+
+    if (control->hasType<mrs_real>())
+    {
+      description.parameters.push_back
+          (make_parameter(control->id(), (float) control->to<mrs_real>(), false));
+    }
+    else if (control->hasType<mrs_natural>())
+    {
+      description.parameters.push_back
+          (make_parameter(control->id(), (float) control->to<mrs_natural>(), true));
+    }
+  }
+}
+
+static bool file_stamp(const string & filename, long long & mtime, long long & size)
+{
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0)
+    return false;
+  mtime = (long long) info.st_mtime;
+  size = (long long) info.st_size;
+  return true;
+}
+
+// VampDescriptionCache
+
+VampDescriptionCache::VampDescriptionCache(const string & filename):
+  m_filename(filename)
+{
+  if (!m_filename.empty() && !load())
+    m_entries.clear();
+}
+
+string VampDescriptionCache::defaultFilename()
+{
+  string dir;
+  const char *xdg_cache = getenv("XDG_CACHE_HOME");
+  const char *home = getenv("HOME");
+  if (xdg_cache && *xdg_cache)
+    dir = xdg_cache;
+  else if (home && *home)
+    dir = string(home) + "/.cache";
+  else
+    return string();
+
+  if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+    return string();
+
+  return dir + "/marsyas-vamp-plugin.cache";
+}
+
+bool VampDescriptionCache::find(const string & script,
+                                VampScriptDescription & description) const
+{
+  map<string, entry>::const_iterator it = m_entries.find(script);
+  if (it == m_entries.end())
+    return false;
+
+  long long mtime, size;
+  if (!file_stamp(script, mtime, size) ||
+      mtime != it->second.mtime || size != it->second.size)
+    return false;
+
+  description = it->second.description;
+  return true;
+}
+
+void VampDescriptionCache::store(const string & script,
+                                 const VampScriptDescription & description)
+{
+  entry e;
+  if (!file_stamp(script, e.mtime, e.size))
+    return;
+  e.description = description;
+  m_entries[script] = e;
+
+  if (!m_filename.empty() && !save())
+    cerr << "WARNING: Failed to save script descriptions: " << m_filename << endl;
+}
+
+// Format, fields separated by tabs:
+//   <header>
+//   <script> <mtime> <size> <time|frequency> <frames|events> <parameter count>
+//   <identifier> <default value> <quantized 0|1>   (for each parameter)
+
+bool VampDescriptionCache::load()
+{
+  ifstream file(m_filename.c_str());
+  if (!file.is_open())
+    return false;
+
+  string line;
+  if (!getline(file, line) || line != cache_header)
+    return false;
+
+  while (getline(file, line))
+  {
+    if (line.empty())
+      continue;
+
+    istringstream fields(line);
+    string script, domain, output_type;
+    entry e;
+    size_t parameter_count;
+    if (!getline(fields, script, '\t') ||
+        !(fields >> e.mtime >> e.size >> domain >> output_type >> parameter_count))
+      return false;
+
+    if (domain == "frequency")
+      e.description.input_domain = Vamp::Plugin::FrequencyDomain;
+    e.description.events = output_type == "events";
+
+    for (size_t i = 0; i < parameter_count; ++i)
+    {
+      string id;
+      float default_value;
+      int quantized;
+      if (!getline(file, line))
+        return false;
+      istringstream param_fields(line);
+      if (!getline(param_fields, id, '\t') ||
+          !(param_fields >> default_value >> quantized))
+        return false;
+      e.description.parameters.push_back(make_parameter(id, default_value, quantized != 0));
+    }
+
+    m_entries[script] = e;
+  }
+
+  return true;
+}
+
+bool VampDescriptionCache::save() const
+{
+  // Written aside and renamed, so concurrent hosts never read a
+  // partial file.
+  ostringstream temp_name;
+  temp_name << m_filename << '.' << getpid();
+  string temp_filename = temp_name.str();
+
+  {
+    ofstream file(temp_filename.c_str());
+    if (!file.is_open())
+      return false;
+
+    file << cache_header << '\n' << setprecision(9);
+
+    map<string, entry>::const_iterator it;
+    for (it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+      const entry & e = it->second;
+      const Vamp::Plugin::ParameterList & parameters = e.description.parameters;
+      file << it->first << '\t' << e.mtime << '\t' << e.size << '\t'
+           << (e.description.input_domain == Vamp::Plugin::FrequencyDomain ?
+                 "frequency" : "time")
+           << '\t' << (e.description.events ? "events" : "frames")
+           << '\t' << parameters.size() << '\n';
+      for (size_t i = 0; i < parameters.size(); ++i)
+      {
+        file << parameters[i].identifier << '\t'
+             << parameters[i].defaultValue << '\t'
+             << (parameters[i].isQuantized ? 1 : 0) << '\n';
+      }
+    }
+
+    if (!file.good())
+    {
+      file.close();
+      remove(temp_filename.c_str());
+      return false;
+    }
+  }
+
+  if (rename(temp_filename.c_str(), m_filename.c_str()) != 0)
+  {
+    remove(temp_filename.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+// VampScript
+
+VampScript::VampScript(const string & filename, MarSystemManager *manager,
+                       VampDescriptionCache *cache):
+  m_filename(filename),
+  m_manager(manager),
+  m_cache(cache),
+  m_prototype(0),
+  m_translated(false),
+  m_described(false)
+{}
+
+VampScript::~VampScript()
+{
+  delete m_prototype;
+}
+
+MarSystem *VampScript::prototype()
+{
+  if (!m_translated)
+  {
+    m_translated = true;
+    m_prototype = translate();
+    if (!m_prototype)
+      cerr << "ERROR: Failed to create prototype for script: " << m_filename << endl;
+  }
+  return m_prototype;
+}
+
+MarSystem *VampScript::translate()
+{
+  return system_from_script(m_filename, m_manager);
+}
+
+const VampScriptDescription & VampScript::description()
+{
+  if (m_described)
+    return m_description;
+
+  m_described = true;
+
+  if (m_cache && m_cache->find(m_filename, m_description))
+    return m_description;
+
+  MarSystem *system = prototype();
+  if (!system)
+    return m_description;
+
+  describe(system, m_description);
+
+  if (m_cache)
+    m_cache->store(m_filename, m_description);
+
+  return m_description;
+}
+
+} // namespace Marsyas
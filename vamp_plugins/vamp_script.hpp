@@ -0,0 +1,91 @@
+#ifndef VAMP_MARSYAS_SCRIPT_INCLUDED
+#define VAMP_MARSYAS_SCRIPT_INCLUDED
+
+#include <vamp-sdk/Plugin.h>
+#include <marsyas/system/MarSystem.h>
+#include <marsyas/system/MarSystemManager.h>
+#include <string>
+#include <map>
+
+namespace Marsyas {
+
+// What a host learns about a script before instantiating it.
+struct VampScriptDescription
+{
+    VampScriptDescription():
+        input_domain(Vamp::Plugin::TimeDomain),
+        events(false)
+    {}
+
+    Vamp::Plugin::InputDomain input_domain;
+    // Output only the non-zero frames, as timestamped features.
+    bool events;
+    Vamp::Plugin::ParameterList parameters;
+};
+
+// Script descriptions persisted in a file between runs, each valid
+// while the script's modification time and size are unchanged.
+// Only the top-level script declares the input domain, output type
+// and public controls, so included scripts need no tracking.
+class VampDescriptionCache
+{
+public:
+    // Loads 'filename'. A missing or invalid file gives an empty cache.
+    VampDescriptionCache(const std::string & filename);
+
+    // Default location: $XDG_CACHE_HOME or ~/.cache, or "" without either.
+    static std::string defaultFilename();
+
+    bool find(const std::string & script, VampScriptDescription & description) const;
+
+    // Adds or replaces the entry for 'script' and saves the file.
+    void store(const std::string & script, const VampScriptDescription & description);
+
+private:
+    struct entry
+    {
+        long long mtime;
+        long long size;
+        VampScriptDescription description;
+    };
+
+    bool load();
+    bool save() const;
+
+    std::string m_filename;
+    std::map<std::string, entry> m_entries;
+};
+
+// A script from the script directory. It is only translated when
+// first needed: to create a plugin instance, or to describe it when
+// its description is not in the cache.
+class VampScript
+{
+public:
+    VampScript(const std::string & filename, MarSystemManager *manager,
+               VampDescriptionCache *cache = 0);
+    ~VampScript();
+
+    const std::string & filename() const { return m_filename; }
+
+    // Returns 0 if the script fails to translate.
+    MarSystem *prototype();
+
+    // A new translation, owned by the caller; 0 on failure.
+    MarSystem *translate();
+
+    const VampScriptDescription & description();
+
+private:
+    std::string m_filename;
+    MarSystemManager *m_manager;
+    VampDescriptionCache *m_cache;
+    MarSystem *m_prototype;
+    bool m_translated;
+    bool m_described;
+    VampScriptDescription m_description;
+};
+
+} // namespace Marsyas
+
+#endif // VAMP_MARSYAS_SCRIPT_INCLUDED